@@ -0,0 +1,249 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FINGBENCH: How does the time taken by Engine::compute() grow with the
+ * size of the input?
+ *
+ * Each input is a pattern of notes repeated out to 100, 1000, ... notes,
+ * and fingered with each of the hand models in turn. Each run is made in a
+ * child process of its own, so that its peak memory isn't that of some
+ * bigger run before it.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <QElapsedTimer>
+#include <holdsworth/types.h>
+#include <holdsworth/instrumentdefn.h>
+#include <holdsworth/constraints.h>
+#include <holdsworth/engine.h>
+#include <holdsworth/vn_algorithm.h>
+#include <holdsworth/trace.h>
+#include "mygetopt.h"
+#include "migt.h"
+
+
+namespace {
+
+    /*! \brief Size of the smallest input tried. Each one after that is
+     * ten times bigger.
+     */
+    const unsigned int bench_min_notes = 100;
+
+    /*! \brief Default size of the biggest input tried.
+     */
+    const unsigned int bench_dflt_max_notes = 1000000;
+
+    /*! \brief The MIGT exercise used as an input: a major scale, in all
+     * step sizes, over two octaves from the bottom A.
+     */
+    const unsigned int bench_migt_scale = 0xab5;
+    const unsigned int bench_migt_start = 45;
+    const unsigned int bench_migt_range = 24;
+
+    const char *hand_names[] = { "standard", "extended", "extended2" };
+
+    void sheetsTest(Holdsworth::NoteList& nl, Holdsworth::InstrumentDefn& t_defn)
+    {
+#define ADD_NOTE(x, y) \
+        nl.push_back(t_defn.noteAt(Holdsworth::FretPos((x), (y))))
+#include "sheets-test.i"
+#undef ADD_NOTE
+    }
+
+    void unmerryTest(Holdsworth::NoteList& nl, Holdsworth::InstrumentDefn& t_defn)
+    {
+#define ADD_NOTE(x, y) \
+        nl.push_back(t_defn.noteAt(Holdsworth::FretPos((x), (y))))
+#include "unmerry-test.i"
+#undef ADD_NOTE
+    }
+
+    /*!
+     * \brief Fill nl with exactly num_notes notes by repeating pattern, then
+     * add the sentinel.
+     */
+    void repeatTo(const Holdsworth::NoteList& pattern, unsigned int num_notes, Holdsworth::NoteList& nl)
+    {
+        nl.clear();
+        nl.reserve(num_notes + 1);
+        while (nl.size() < num_notes) {
+            unsigned int n = qMin((unsigned int) pattern.size(), num_notes - (unsigned int) nl.size());
+            nl.insert(nl.end(), pattern.begin(), pattern.begin() + n);
+        }
+        nl.push_back(Holdsworth::Note(Holdsworth::NotDefined));
+    }
+
+
+    void show_usage()
+    {
+        std::cout << "usage: fingbench <options>" << std::endl << std::endl;
+        std::cout << "--max-notes=N       Biggest input to try (default: " << bench_dflt_max_notes << ")" << std::endl;
+        std::cout << "--input=NAME        Only try the migt, sheets or unmerry input" << std::endl;
+        std::cout << "--global            Use a single-pass global search instead of auto-hinted chunks" << std::endl;
+        std::cout << "--segments          Finger the parts between restart hints independently, in parallel" << std::endl;
+        std::cout << "--threads=N         Use N threads to generate candidate chunks" << std::endl;
+        std::cout << "--max-passes=N      Give up auto-hinting after N passes (default: 50)" << std::endl;
+        std::cout << "--help              This message" << std::endl;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    GetOpt opts(argc, argv);
+
+    Holdsworth::setTraceLevel(Holdsworth::TraceNone);
+
+    bool usage = false;
+    bool global = false;
+    bool segments = false;
+    QString max_notes_str;
+    QString input_name;
+    QString threads_str;
+    QString max_passes_str;
+
+    opts.addSwitch("help", &usage);
+    opts.addSwitch("global", &global);
+    opts.addSwitch("segments", &segments);
+    opts.addOption('n', "max-notes", &max_notes_str);
+    opts.addOption('i', "input", &input_name);
+    opts.addOption('j', "threads", &threads_str);
+    opts.addOption('p', "max-passes", &max_passes_str);
+
+    if (!opts.parse()) {
+        show_usage();
+        return 1;
+    }
+    if (usage) {
+        show_usage();
+        return 0;
+    }
+
+    unsigned int max_notes = bench_dflt_max_notes;
+    if (!max_notes_str.isEmpty()) {
+        max_notes = max_notes_str.toUInt();
+    }
+    int max_passes = 50;
+    if (!max_passes_str.isEmpty()) {
+        max_passes = max_passes_str.toInt();
+    }
+
+    Holdsworth::InstrumentDefn t_defn;
+
+    /*
+     * The patterns that are repeated to make up the inputs.
+     */
+    std::vector<QString> names;
+    std::vector<Holdsworth::NoteList> patterns;
+
+    names.push_back("migt");
+    patterns.push_back(Holdsworth::NoteList());
+    generateMIGT(bench_migt_scale, 0, bench_migt_start, bench_migt_range, patterns.back());
+
+    names.push_back("sheets");
+    patterns.push_back(Holdsworth::NoteList());
+    sheetsTest(patterns.back(), t_defn);
+
+    names.push_back("unmerry");
+    patterns.push_back(Holdsworth::NoteList());
+    unmerryTest(patterns.back(), t_defn);
+
+    std::cout << std::setw(8) << "Input"
+        << std::setw(10) << "Hand"
+        << std::setw(9) << "Notes"
+        << std::setw(10) << "ms"
+        << std::setw(11) << "Notes/sec"
+        << std::setw(7) << "Passes"
+        << std::setw(10) << "Hits"
+        << std::setw(10) << "Misses"
+        << std::setw(11) << "Peak kB" << std::endl;
+
+    for (unsigned int i = 0; i < patterns.size(); ++i) {
+        if (!input_name.isEmpty() && (input_name != names[i])) {
+            continue;
+        }
+
+        for (int hand = 0; hand < 3; ++hand) {
+            for (unsigned int num_notes = bench_min_notes; num_notes <= max_notes; num_notes *= 10) {
+                std::cout.flush();
+                pid_t pid = fork();
+                if (pid < 0) {
+                    std::cout << "Can't fork" << std::endl;
+                    return 1;
+                }
+                if (pid == 0) {
+                    Holdsworth::NoteList nl;
+                    repeatTo(patterns[i], num_notes, nl);
+
+                    Holdsworth::Algorithm *t_alg;
+                    if (hand == 2) {
+                        t_alg = new Holdsworth::VNAlgorithmX2;
+                    }
+                    else if (hand == 1) {
+                        t_alg = new Holdsworth::VNAlgorithmX;
+                    }
+                    else {
+                        t_alg = new Holdsworth::VNAlgorithm;
+                    }
+
+                    Holdsworth::Constraints t_constraints;
+                    t_constraints.setBTBGliss(false);
+
+                    Holdsworth::Engine t_engine;
+                    if (global) {
+                        t_engine.setSearchMode(Holdsworth::Engine::GlobalSearch);
+                    }
+                    t_engine.setSplitAtRestarts(segments);
+                    if (!threads_str.isEmpty()) {
+                        t_engine.setThreads(threads_str.toInt());
+                    }
+                    t_engine.setInstrument(&t_defn);
+                    t_engine.setAlgorithm(t_alg);
+                    t_engine.setConstraints(&t_constraints);
+
+                    QElapsedTimer t;
+                    t.start();
+                    bool ok = t_engine.compute(nl, max_passes);
+                    qint64 ns = t.nsecsElapsed();
+
+                    const Holdsworth::EngineStatistics& es = t_engine.statistics();
+                    std::cout << std::setw(8) << names[i].toLatin1().data()
+                        << std::setw(10) << hand_names[hand]
+                        << std::setw(9) << num_notes
+                        << std::setw(10) << std::fixed << std::setprecision(2) << ns / 1.0e6
+                        << std::setw(11) << (qint64) (num_notes * 1.0e9 / qMax(ns, (qint64) 1))
+                        << std::setw(7) << es.passes
+                        << std::setw(10) << es.chunk_cache_hits
+                        << std::setw(10) << es.chunk_cache_misses;
+                    std::cout.flush();
+                    _exit(ok ? 0 : 1);
+                }
+
+                /*
+                 * The peak is only known once the child has gone.
+                 */
+                int status;
+                struct rusage ru;
+                if (wait4(pid, &status, 0, &ru) != pid) {
+                    std::cout << "  Lost the child process" << std::endl;
+                    return 1;
+                }
+                std::cout << std::setw(11) << ru.ru_maxrss;
+                if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+                    std::cout << "  FAILED";
+                }
+                std::cout << std::endl;
+
+                if (num_notes > max_notes / 10) {
+                    break;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+# Scaling benchmark for Engine::compute. Build with "qmake && make" in this
+# directory, and run ./fingbench --help for the options.
+
+TEMPLATE=app
+TARGET=fingbench
+CONFIG+=qt thread console
+CONFIG-=app_bundle
+
+OBJECTS_DIR=.obj
+INCLUDEPATH += ..
+SOURCES += bench.cpp
+SOURCES += ../getopt.cpp
+HEADERS += ../mygetopt.h
+SOURCES += ../migt.cpp
+HEADERS += ../migt.h
+
+include(../holdsworth/holdsworth.pri)
+
+QT-=gui
@@ -6,37 +6,19 @@ OBJECTS_DIR=.obj
 SOURCES += main.cpp
 SOURCES += getopt.cpp
 HEADERS += mygetopt.h
+SOURCES += sweep.cpp
+HEADERS += sweep.h
+SOURCES += migt.cpp
+HEADERS += migt.h
+SOURCES += lilypond.cpp
+HEADERS += lilypond.h
+SOURCES += server.cpp
+HEADERS += server.h
 
-HEADERS += holdsworth/algorithm.h
-HEADERS += holdsworth/vn_algorithm.h
-HEADERS += holdsworth/chunk.h
-HEADERS += holdsworth/constraints.h
-HEADERS += holdsworth/engine.h
-HEADERS += holdsworth/instrumentdefn.h
-HEADERS += holdsworth/note.h
-HEADERS += holdsworth/types.h
-HEADERS += holdsworth/debugging.h
-HEADERS += holdsworth/handmodel.h
-HEADERS += holdsworth/handmodelx.h
-HEADERS += holdsworth/handmodelx2.h
-HEADERS += holdsworth/musicxmlloader.h
-HEADERS += holdsworth/musicxmlreader.h
+include(holdsworth/holdsworth.pri)
 
-SOURCES += holdsworth/algorithm.cpp
-SOURCES += holdsworth/vn_algorithm.cpp
-SOURCES += holdsworth/chunk.cpp
-SOURCES += holdsworth/engine.cpp
-SOURCES += holdsworth/instrumentdefn.cpp
-SOURCES += holdsworth/note.cpp
-SOURCES += holdsworth/debugging.cpp
-SOURCES += holdsworth/handmodel.cpp
-SOURCES += holdsworth/handmodelx.cpp
-SOURCES += holdsworth/handmodelx2.cpp
-SOURCES += holdsworth/musicxmlloader.cpp
-SOURCES += holdsworth/musicxmlreader.cpp
-
-#DEFINES+=SOME_DEBUG
-#DEFINES+=EXTRA_DEBUG
+# --trace=3 needs the note-by-note tracing compiled in
+#DEFINES+=HOLDSWORTH_MAX_TRACE=3
 
 DISTFILES += Doxyfile
 DISTFILES += README
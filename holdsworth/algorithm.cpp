@@ -23,6 +23,7 @@
 #include "algorithm.h"
 #include "instrumentdefn.h"
 #include "handmodel.h"
+#include "trace.h"
 
 namespace Holdsworth {
 
@@ -30,6 +31,7 @@ namespace Holdsworth {
 	: instrument_(0)
 	, constraints_(0)
 	, handmodel_(0)
+	, weights_()
     {
     }
 
@@ -45,21 +47,25 @@ namespace Holdsworth {
 	constraints_ = the_constraints;
     }
 
+    bool Algorithm::acceptsStart(const FingerPosition& p, const FretPos& fp, const Fingering& force_first)
+    {
+	return (force_first.finger == NoFingerDefined)
+	    || (force_first.finger == handmodel_->getFinger(fp.fret, p));
+    }
+
     void Algorithm::setHandModel(HandModel *the_model)
     {
 	Q_ASSERT(the_model != 0);
 	handmodel_ = the_model;
     }
 
-    FingerPositionList Algorithm::candidates(const FretPos& x)
+    const FingerPositionList& Algorithm::candidates(const FretPos& x)
     {
-#ifdef EXTRA_DEBUG
-	qDebug("FingerPositionList Algorithm::candidates for fretpos= s: %d f: %d", x.strg, x.fret);
-#endif
+	TRACE(TraceDebug) << "Algorithm::candidates for fretpos s: " << x.strg << " f: " << x.fret << std::endl;
 	return handmodel_->candidates(x);
     }
 
-    FretPosList Algorithm::candidates(const Note& y) 
+    const FretPosList& Algorithm::candidates(const Note& y) 
     {
 	return instrument_->candidates(y);
     }
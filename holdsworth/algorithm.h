@@ -26,6 +26,7 @@
 #include <holdsworth/types.h>
 #include <holdsworth/note.h>
 #include <holdsworth/chunk.h>
+#include <holdsworth/costweights.h>
 
 namespace Holdsworth {
 
@@ -53,27 +54,84 @@ public:
      */
     virtual Chunk generateChunk(ConstNoteIterator starting_note, const FingerPosition&, const FretPos&, const Fingering& force_first, const Note *lead_in) = 0;
 
+    /*!
+     * \brief Score a block of fingering without building it.
+     *
+     * This must agree with generateChunk() on the cost and length of the
+     * chunk, but need not record the fingering of every note.
+     *
+     * \param bound      The cost the chunk must get down to in order to be of
+     *                   any interest.
+     * \param notes_left notes_left[i] is the number of notes (not rests) from
+     *                   the i-th note of the chunk up to the next position
+     *                   break, or 0 to score the chunk in full.
+     *
+     * If the chunk provably cannot end up costing bound or less, the
+     * algorithm may stop early and return a pruned score.
+     */
+    virtual ChunkScore scoreChunk(ConstNoteIterator starting_note, const FingerPosition&, const FretPos&, const Fingering& force_first, const Note *lead_in, int bound, const unsigned int *notes_left) = 0;
+
+    /*!
+     * \brief Can a chunk start with the given fret in the given position?
+     *
+     * This is a cheap check, made before any work is done on the chunk,
+     * that the starting finger mandated by the input can be honoured.
+     */
+    virtual bool acceptsStart(const FingerPosition&, const FretPos&, const Fingering& force_first);
+
+    /*!
+     * \brief Finger the first note of a chunk.
+     *
+     * \param start_p       LH position of the chunk
+     * \param lead_in       Fingering of the note before the chunk, or 0 if starting afresh
+     * \param force_first   Fingering mandated by the input
+     * \param f             On entry, the string and fret of the note plus any input
+     *                      annotations. On exit, the complete fingering.
+     * \param cost          On exit, the cost of starting a chunk with this note.
+     *
+     * \return false if the mandated fingering cannot be honoured.
+     */
+    virtual bool startFingering(const FingerPosition& start_p, const Fingering *lead_in, const Fingering& force_first, Fingering& f, int& cost) = 0;
+
+    /*!
+     * \brief Finger a note that continues a chunk without changing position.
+     *
+     * \param p             LH position of the chunk
+     * \param current       Fingering of the previous note in the chunk
+     * \param mandated      Fingering mandated by the input
+     * \param f             On entry, the string and fret of the note. On exit, the
+     *                      complete fingering.
+     * \param cost          On exit, the cost of adding the note to the chunk. This
+     *                      may be negative.
+     *
+     * \return false if the note cannot sensibly be played without breaking position.
+     */
+    virtual bool nextFingering(const FingerPosition& p, const Fingering& current, const Fingering& mandated, Fingering& f, int& cost) = 0;
+
     /*! \brief Return candidate positions for a given position on the
      * fingerboard.
      */
-    virtual FingerPositionList candidates(const FretPos&);
+    virtual const FingerPositionList& candidates(const FretPos&);
 
     /*! \brief Return candidate fret positions for a given note.
      *
      * This is a convenience wrapper which calls into the underlying method of the
      * InstrumentDefn.
      */
-    virtual FretPosList candidates(const Note&);
+    virtual const FretPosList& candidates(const Note&);
 
 
     void setInstrument(InstrumentDefn *);   /*!< \brief Settor function for associated InstrumentDefn */
     void setConstraints(Constraints *);	    /*!< \brief Settor function for associated Constraints */
     void setHandModel(HandModel *);	    /*!< \brief Settor function for associated Hand Model */
+    void setCostWeights(const CostWeights& w) { weights_ = w; }	/*!< \brief Settor function for the cost weights */
+    const CostWeights& costWeights() const { return weights_; }	/*!< \brief Accessor function for the cost weights */
 
 protected:
     InstrumentDefn *instrument_;
     Constraints *constraints_;
     HandModel *handmodel_;
+    CostWeights weights_;
 
 };
 
@@ -27,9 +27,11 @@
 namespace Holdsworth {
 
     Chunk::Chunk()
-	: notes_()
+	: start_()
+	, fingerings_()
 	, position_(NotDefined)
 	, cost_(0)
+	, diagram_()
     {
 	/*
 	 * Nothing
@@ -43,7 +45,7 @@ namespace Holdsworth {
 
     unsigned int Chunk::length() const
     {
-	return notes_.size();
+	return fingerings_.size();
     }
 
     void Chunk::addCost(int the_added_cost)
@@ -51,37 +53,50 @@ namespace Holdsworth {
 	cost_ += the_added_cost;
     }
 
-    void Chunk::addNote(const Note& the_note){
-	notes_.push_back(the_note);
+    void Chunk::addFingering(const Fingering& the_fingering)
+    {
+	fingerings_.push_back(the_fingering);
+    }
+
+    void Chunk::appendTo(NoteList& the_notelist) const
+    {
+        ConstNoteIterator src = start_;
+        for (std::vector<Fingering>::const_iterator f = fingerings_.begin();
+                f != fingerings_.end();
+                ++f, ++src)
+        {
+            Note n((*src).noteNum());
+            n.setDuration((*src).duration());
+            n.setFingering(*f);
+            the_notelist.push_back(n);
+        }
     }
 
     void Chunk::dbgDump() const
     {
-#ifdef EXTRA_DEBUG
+	NoteList notes;
+	appendTo(notes);
 
 	qDebug("~~~~~~~~~~~~~~~~");
 	qDebug("Dump of chunk @ posn %d:", position_);
-	dbgDumpNoteList(notes_);
+	dbgDumpNoteList(notes);
 	qDebug("~~~~~~~~~~~~~~~~");
-#endif
     }
     
     std::string Chunk::lilypondFretDiagram() const
     {
         QString s("\\fret-diagram #\"s:1;f:1;");
-#ifdef EXTRA_DEBUG
-        qDebug("lilypondFretDiagram");
-#endif
-        for (NoteList::const_iterator n = notes_.begin();
-                n != notes_.end();
-                ++n)
+        for (std::vector<Fingering>::const_iterator f = fingerings_.begin();
+                f != fingerings_.end();
+                ++f)
         {
-            if ((*n).noteNum() == 0) {
+            if ((*f).strg == NotDefined) {
+                /* Rest */
                 continue;
             }
             QString fingerdot;
-            fingerdot.sprintf("%d-%d-%d;", 7 - (*n).stringNum(), (*n).fretNum(), (*n).fingerNum());
-            if (!(*n).hasAnnotation(ANNO_QSHIFT)) {
+            fingerdot.sprintf("%d-%d-%d;", 7 - (*f).strg, (*f).fret, (*f).finger);
+            if (!(*f).hasAnnotation(ANNO_QSHIFT)) {
                 if (!s.contains(fingerdot)) {
                     s += fingerdot;
                 }
@@ -89,30 +104,27 @@ namespace Holdsworth {
         }
 
         s += "\"";
-#ifdef EXTRA_DEBUG
-        qDebug() << s;
-#endif
         return std::string(s.toLatin1().data());
     }
 
     void Chunk::makeFretDiag()
     {
-        if (notes_.size() > 2) {
-            notes_.front().setDiagram(lilypondFretDiagram());
+        if (fingerings_.size() > 2) {
+            diagram_ = lilypondFretDiagram();
         }
     }
 
     void Chunk::tagPositionShift()
     {
-        if (!notes_.empty()) {
-            if (notes_.front().hasAnnotation(HINT_SHIFT_UP)) {
+        if (!fingerings_.empty()) {
+            if (fingerings_.front().hasAnnotation(HINT_SHIFT_UP)) {
 		;
             }
-            else if (notes_.front().hasAnnotation(HINT_SHIFT_DOWN)) {
+            else if (fingerings_.front().hasAnnotation(HINT_SHIFT_DOWN)) {
 		;
             }
             else {
-                notes_.front().addAnnotation(ANNO_SHIFT);
+                fingerings_.front().addAnnotation(ANNO_SHIFT);
             }
         }
     }
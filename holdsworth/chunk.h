@@ -26,6 +26,7 @@
 #include <holdsworth/note.h>
 #include <string>
 #include <list>
+#include <vector>
 
 namespace Holdsworth {
 
@@ -33,6 +34,9 @@ namespace Holdsworth {
 /*!
  *  \brief A block of fingered notes in a given position.
  *
+ * A chunk does not hold copies of its notes, only a reference to the first
+ * one in the source list and the fingering of each. The notes themselves
+ * are only built (by appendTo()) for the chunks that are actually chosen.
  */
 class Chunk
 {
@@ -44,11 +48,19 @@ public:
     int cost() const;			/*!< \brief Returns overall "penalty score" of chunk. */
 
     void addCost(int);			/*!< \brief Add penalty points to the chunk.*/
-    void addNote(const Note&);		/*!< \brief Add a note to the chunk. */
+
+    /*! \brief Add the fingering of the next note to the chunk.
+     *
+     * Rests take a default constructed Fingering.
+     */
+    void addFingering(const Fingering&);
 
     void setPosition(FingerPosition x) {position_ = x;}	    /*!< \brief Settor function for position. */
     FingerPosition getPosition() const {return position_;}  /*!< \brief Gettor function for position. */
 
+    void setStart(ConstNoteIterator x) {start_ = x;}	    /*!< \brief Settor function for the first source note. */
+    ConstNoteIterator start() const {return start_;}	    /*!< \brief Gettor function for the first source note. */
+
     void dbgDump() const;
 
     /*! \brief Generate fret diagram suitable for Lilypond markup.
@@ -59,28 +71,54 @@ public:
      */
     std::string lilypondFretDiagram() const;
 
-    /*! \brief Return a reference to the internal note list.
+    /*! \brief Return the fingerings of the notes in the chunk.
+     */
+    const std::vector<Fingering>& fingerings() const {return fingerings_;}
+
+    /*! \brief Append the fingered notes of the chunk to a list.
      *
-     * This reference of course may become invalid, so it should be
-     * used immediately as the RHS of a NoteList += operation.
+     * The source notes must still be valid.
      */
-    const NoteList& noteList() const {return notes_;}
+    void appendTo(NoteList&) const;
 
     /*! \brief Create and store a fretboard diagram for this chunk.
      */
     void makeFretDiag();
 
+    /*! \brief The diagram made by makeFretDiag(), for the first note of the
+     * chunk. Empty if there isn't one.
+     */
+    const std::string& fretDiagram() const {return diagram_;}
+
     /*! \brief Tag this chunk as a shift of LH position.
      */
     void tagPositionShift();
 
 private:
-    NoteList notes_;
+    ConstNoteIterator start_;
+    std::vector<Fingering> fingerings_;
     FingerPosition position_;
     int cost_;
+    std::string diagram_;
 
 };
 
+/*! \brief Outcome of a chunk, without the fingerings of its notes.
+ */
+struct ChunkScore {
+    ChunkScore()
+        : cost(0)
+        , length(0)
+        , last()
+        , pruned(false)
+        {}
+
+    int cost;               /*!< Overall "penalty score" of the chunk */
+    unsigned int length;    /*!< Number of notes in the chunk */
+    Fingering last;         /*!< Fingering of the last fingered (non-rest) note */
+    bool pruned;            /*!< Abandoned early: cost and length are partial */
+};
+
 /*! \brief A list of chunks.
  *
  * Typically, each chunk will be in a different position
@@ -0,0 +1,168 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+/***************************************************************************
+ *   Copyright (C) 2006 by Vince Negri                                     *
+ *   vince.negri@gmail.com                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <qglobal.h>
+#include "costweights.h"
+
+namespace {
+
+    /*! \brief The bonus assigned to adding a new note to a chunk.
+     * 
+     * This must always outweigh the "typical" cost of a note, or you will get
+     * silly results.
+     *
+     * The bigger the bonus (the more negative the value), the more Holdsworth
+     * will favour awkward finger moves that allow you stay in one position for
+     * longer.
+     */
+    const int vn_note_bonus = -5;
+
+    /*! \brief The maximum cost that can borne on a single note before it becomes worth
+     * trying to break position.
+     *
+     * If the cost passes this level, we try position shifts instead.
+     * where we currently are. It may turn out that staying in the same
+     * position is still best.
+     */
+    const int vn_position_break_threshold = 15;
+
+    /*! \brief The maximum cost that can be accumulated before it becomes worth
+     * trying to break position.
+     *
+     * If the cost passes this level, we look afresh for a best position from
+     * where we currently are. It may turn out that staying in the same
+     * position is still best.
+     */
+    //const int vn_cumulative_position_break_threshold = 20;
+
+    /*! \brief The penalty assigned to changing strings.
+     */
+    const int vn_string_change = 1;
+
+    /*! \brief The penalty assigned to a Q-shift (using the "wrong" finger for
+     * a note)
+     */
+    const int vn_q_shift_penalty = 5;
+
+    /*! \brief The penalty assigned to a T-move (transferring a finger between
+     * strings on successive notes, higher string to lower string)
+     */
+    const int vn_t_move_penalty = 10;
+
+
+    /*! \brief The penalty assigned to a traditional layover.
+     */
+    const int vn_layover_penalty = 2;
+    
+    /*! \brief The penalty assigned to an O-move (transferring a finger between
+     * strings on successive notes, lower string to higher string)
+     *
+     * An O-move is a sort of sliding layover, so is easier than a T-move.
+     */
+    const int vn_o_move_penalty = 10;
+
+    /*! \brief The penalty assigned to an A-move (transferring a finger between
+     * notes on successive notes, same string, but <b>without</b> a slur effect)
+     */
+    const int vn_a_move_penalty = 10;
+
+    /*! \brief The penalty assigned to an awkward position change fingering.
+     */
+    const int vn_bad_pos_change_penalty = 10;
+
+    /*! \brief The penalty assigned to taking a note on the little finger.
+     *
+     * Other things being equal, it is nice to avoid notes on the little finger
+     * as some people find it awkward. So we assign a small penalty to pinky
+     * notes. It is only small though, to act as a tiebreaker.  Taking a note
+     * on the pinky is always better than some other nasty position shift.
+     */
+    const int vn_pinky_penalty = 1;
+
+    /*! \brief The penalty assigned to using a first finger extension.
+     */
+    const int vn_index_stretch_penalty = 1;
+
+    /*! \brief The penalty assigned to using a little finger extension. This is in
+     * addition to the usual penalty.
+     */
+    const int vn_pinky_stretch_penalty = 1;
+
+    /*! \brief The smallest size of chunk in which autohints can be inserted.
+     *
+     * If there is a genuinely big position shift inherent in the input line,
+     * then no amount of break hinting can avoid it. This threshold stops the
+     * engine persisting in a futile attempt to square the circle.
+     *
+     * This is a "seems to work" value and some experiment is needed to find the
+     * best one. However, once discovered it is likely this value will hold for
+     * most algorithms.
+     */
+    const int engine_auto_hint_giveup_size = 12;
+}
+
+namespace Holdsworth {
+
+    CostWeights::CostWeights()
+        : note_bonus(vn_note_bonus)
+        , position_break_threshold(vn_position_break_threshold)
+        , string_change(vn_string_change)
+        , q_shift_penalty(vn_q_shift_penalty)
+        , t_move_penalty(vn_t_move_penalty)
+        , layover_penalty(vn_layover_penalty)
+        , o_move_penalty(vn_o_move_penalty)
+        , a_move_penalty(vn_a_move_penalty)
+        , bad_pos_change_penalty(vn_bad_pos_change_penalty)
+        , pinky_penalty(vn_pinky_penalty)
+        , index_stretch_penalty(vn_index_stretch_penalty)
+        , pinky_stretch_penalty(vn_pinky_stretch_penalty)
+        , auto_hint_giveup_size(engine_auto_hint_giveup_size)
+    {
+    }
+
+    bool CostWeights::set(const std::string& name, int value)
+    {
+        /*
+         * The pruning of chunks counts on no penalty being negative, and
+         * auto_hint_giveup_size is a number of notes. The bonus and the
+         * break threshold are neither, so can be anything.
+         */
+        if ((value < 0) && (name != "note_bonus") && (name != "position_break_threshold")) {
+            return false;
+        }
+#define WEIGHT(x) if (name == #x) { x = value; return true; }
+        WEIGHT(note_bonus)
+        WEIGHT(position_break_threshold)
+        WEIGHT(string_change)
+        WEIGHT(q_shift_penalty)
+        WEIGHT(t_move_penalty)
+        WEIGHT(layover_penalty)
+        WEIGHT(o_move_penalty)
+        WEIGHT(a_move_penalty)
+        WEIGHT(bad_pos_change_penalty)
+        WEIGHT(pinky_penalty)
+        WEIGHT(index_stretch_penalty)
+        WEIGHT(pinky_stretch_penalty)
+        WEIGHT(auto_hint_giveup_size)
+#undef WEIGHT
+        return false;
+    }
+}
@@ -0,0 +1,67 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+/***************************************************************************
+ *   Copyright (C) 2006 by Vince Negri                                     *
+ *   vince.negri@gmail.com                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef HOLDSWORTH_COSTWEIGHTS_H
+#define HOLDSWORTH_COSTWEIGHTS_H
+
+#include <string>
+
+namespace Holdsworth {
+
+/*!
+ * \brief The weights that the algorithm and the engine put on each kind of
+ * awkwardness.
+ *
+ * The default constructor gives the standard weights; see costweights.cpp
+ * for what each one means. Other weights can be tried out at run time with
+ * set(), e.g. to tune them against a collection of scores.
+ */
+struct CostWeights
+{
+    CostWeights();
+
+    /*!
+     * \brief Set the weight with the given name (the member name, e.g.
+     * "note_bonus") to the given value.
+     *
+     * \return false if there is no such weight, or if value is negative
+     * for a penalty or for auto_hint_giveup_size. Only note_bonus and
+     * position_break_threshold may be negative.
+     */
+    bool set(const std::string& name, int value);
+
+    int note_bonus;
+    int position_break_threshold;
+    int string_change;
+    int q_shift_penalty;
+    int t_move_penalty;
+    int layover_penalty;
+    int o_move_penalty;
+    int a_move_penalty;
+    int bad_pos_change_penalty;
+    int pinky_penalty;
+    int index_stretch_penalty;
+    int pinky_stretch_penalty;
+    int auto_hint_giveup_size;
+};
+
+}
+#endif /* HOLDSWORTH_COSTWEIGHTS_H */
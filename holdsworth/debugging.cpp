@@ -192,11 +192,8 @@ namespace Holdsworth {
             qDebug("%s", (*n).dbgDump().c_str());
         }
     }
-    void dbgLilypondDumpNoteList(const NoteList &the_notelist, QTextStream& os, bool with_extras, bool use_flats, bool show_annotations)
+    void dbgLilypondDumpNoteList(const NoteList &the_notelist, QTextStream& os, bool with_extras, bool use_flats, bool show_annotations, const FretDiagramMap *diagrams)
     {
-#ifdef EXTRA_DEBUG
-        qDebug("dbgLilypondDumpNoteList");
-#endif
         const char** lilynotenames = lilynotenames_sharp;
         if (use_flats) {
             lilynotenames = lilynotenames_flat;
@@ -296,12 +293,20 @@ namespace Holdsworth {
                 }
 
                 if (with_extras) {
-                    if (a.isEmpty() && (*n).lilypondDiagram().empty()) {
+                    const char *diagram = 0;
+                    if (diagrams != 0) {
+                        FretDiagramMap::const_iterator d = diagrams->find(n - the_notelist.begin());
+                        if (d != diagrams->end()) {
+                            diagram = (*d).second.c_str();
+                        }
+                    }
+
+                    if (a.isEmpty() && (diagram == 0)) {
                     }
                     else {
                         os << "^\\markup { \\center-column {  ";
-                        if (!(*n).lilypondDiagram().empty()) {
-                            os << (*n).lilypondDiagram().c_str();
+                        if (diagram != 0) {
+                            os << diagram;
                         }
 
                         if (!a.isEmpty() && show_annotations) {
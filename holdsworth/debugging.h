@@ -28,7 +28,7 @@
 namespace Holdsworth {
 
     void dbgDumpNoteList(const NoteList &the_notelist);
-    void dbgLilypondDumpNoteList(const NoteList &the_notelist, QTextStream& os, bool with_extras, bool use_flats, bool show_annotations);
+    void dbgLilypondDumpNoteList(const NoteList &the_notelist, QTextStream& os, bool with_extras, bool use_flats, bool show_annotations, const FretDiagramMap *diagrams = 0);
     const char* dbgLilypondKeySig(int cycle_of_fifths);
 }
 
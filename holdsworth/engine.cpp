@@ -20,13 +20,22 @@
  ***************************************************************************/
 
 #include "engine.h"
+#include "score.h"
+#include "resultcache.h"
 #include "debugging.h"
+#include "trace.h"
 #include <iostream>
 #include <QDebug>
-extern bool quiet;
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <typeinfo>
 /*! \todo this should go into Constraints */
 
-#define OUTPUT  if (!quiet) std::cout 
+/*
+ * Progress output, for segments that are allowed to make it.
+ */
+#define OUTPUT(seg)  if (!(seg).progress) {} else TRACE(TraceProgress)
 
 
 namespace Holdsworth {
@@ -63,17 +72,22 @@ namespace Holdsworth {
      */
     const int dflt_engine_nice_lh_shift = dflt_engine_max_lh_shift / 2;
 
-    /*! \brief The smallest size of chunk in which autohints can be inserted.
+    /*! \brief Penalty per fret for position shifts larger than the maximum LH
+     * shift, in a global search.
      *
-     * If there is a genuinely big position shift inherent in the input line,
-     * then no amount of break hinting can avoid it. This threshold stops the
-     * engine persisting in a futile attempt to square the circle.
-     *
-     * This is a "seems to work" value and some experiment is needed to find the
-     * best one. However, once discovered it is likely this value will hold for
-     * most algorithms.
+     * A global search has no auto-hinter to break up over-long chunks, so
+     * instead it is simply told that big jumps are expensive.
+     */
+    const int engine_excess_shift_penalty = 5;
+
+    /*! \brief Penalty for a chunk of just one note, when there is no
+     * previous chunk to compare its position with.
+     */
+    const int engine_single_note_penalty = 5;
+
+    /*! \brief Cost that any chunk worth having will beat.
      */
-    const uint engine_auto_hint_giveup_size = 12;
+    const int engine_no_chunk_cost = 1000000;
 
     static inline int absolute_diff(FingerPosition a, FingerPosition b)
     {
@@ -85,28 +99,325 @@ namespace Holdsworth {
 	, constraints_(0)
 	, algorithm_(0)
         , nlist_()
-        , source_note_list_()
-        , hint_location_()
-        , hint_type_()
+        , diagrams_()
         , max_lh_shift(dflt_engine_max_lh_shift)
+        , search_mode_(ChunkSearch)
+        , stats_()
+        , threads_(1)
+        , pool_(0)
+        , split_segments_(false)
+        , progress_(true)
+        , result_cache_(0)
+        , stream_layers_()
+        , stream_notes_()
+        , stream_anchored_(false)
+        , stream_lookahead_(0)
+        , stream_fp_(NotDefined)
+        , stream_output_()
 	{/*empty*/}
-    
-    bool Engine::compute(const NoteList& source_notelist, int max_pass)
+
+    Engine::Segment::Segment()
+        : source()
+        , output()
+        , diagrams()
+        , hint_locations()
+        , hint_type(ANNO_NONE)
+        , chunk_cache()
+        , layers()
+        , first_fp(NotDefined)
+        , last_fp(NotDefined)
+        , stats()
+        , threaded(false)
+        , progress(true)
+        , ok(false)
+    {
+        /* Nothing */
+    }
+
+    /*!
+     * \brief Fingers one segment of the input, in a worker thread.
+     */
+    class Engine::SegmentWorker : public QRunnable
+    {
+    public:
+        SegmentWorker(Engine *engine, Segment& seg, int max_pass)
+            : engine_(engine)
+            , seg_(seg)
+            , max_pass_(max_pass)
+            {/*empty*/}
+
+        virtual void run()
+        {
+            seg_.ok = engine_->computeSegment(seg_, max_pass_);
+        }
+
+    private:
+        Engine *engine_;
+        Segment& seg_;
+        int max_pass_;
+    };
+
+    /*!
+     * \brief Fingers one part of a score, on an engine of its own, in a
+     * worker thread.
+     */
+    class Engine::PartWorker : public QRunnable
+    {
+    public:
+        PartWorker(Engine *engine, ScorePart& part, int max_pass)
+            : engine_(engine)
+            , part_(part)
+            , max_pass_(max_pass)
+            {/*empty*/}
+
+        virtual void run()
+        {
+            part_.ok = engine_->compute(part_.notes, max_pass_);
+            part_.output = engine_->output();
+            part_.diagrams = engine_->diagrams();
+            part_.stats = engine_->statistics();
+        }
+
+    private:
+        Engine *engine_;
+        ScorePart& part_;
+        int max_pass_;
+    };
+
+    Engine::~Engine()
+    {
+        delete pool_;
+    }
+
+    bool Engine::ChunkKey::operator<(const ChunkKey& x) const
+    {
+        if (note != x.note) return (note < x.note);
+        if (position != x.position) return (position < x.position);
+        if (start.strg != x.start.strg) return (start.strg < x.start.strg);
+        if (start.fret != x.start.fret) return (start.fret < x.start.fret);
+        if (force_finger != x.force_finger) return (force_finger < x.force_finger);
+        if (lead_in.strg != x.lead_in.strg) return (lead_in.strg < x.lead_in.strg);
+        if (lead_in.fret != x.lead_in.fret) return (lead_in.fret < x.lead_in.fret);
+        return (lead_in.finger < x.lead_in.finger);
+    }
+
+    /*!
+     * \brief Generates the chunks for a set of candidate starts, in a
+     * worker thread.
+     *
+     * Workers take candidates in turn from a shared counter until there
+     * are none left, so a few expensive chunks do not hold up the rest.
+     */
+    class Engine::ChunkWorker : public QRunnable
+    {
+    public:
+        ChunkWorker(Algorithm *algorithm,
+                    std::vector<ChunkCandidate*>& todo,
+                    QAtomicInt& next,
+                    QAtomicInt& best,
+                    ConstNoteIterator cni,
+                    const Fingering& force_first,
+                    const Note *lead_in,
+                    const unsigned int *notes_left)
+            : algorithm_(algorithm)
+            , todo_(todo)
+            , next_(next)
+            , best_(best)
+            , cni_(cni)
+            , force_first_(force_first)
+            , lead_in_(lead_in)
+            , notes_left_(notes_left)
+            {/*empty*/}
+
+        virtual void run()
+        {
+            int i;
+            while ((i = next_.fetchAndAddOrdered(1)) < (int) todo_.size()) {
+                ChunkCandidate& x = *todo_[i];
+                x.score = algorithm_->scoreChunk(cni_, x.position, x.start, force_first_, lead_in_,
+                                                 best_.loadAcquire() - x.position_cost, notes_left_);
+                if (!x.score.pruned) {
+                    offerBest(best_, chunkTotal(x));
+                }
+            }
+        }
+
+    private:
+        Algorithm *algorithm_;
+        std::vector<ChunkCandidate*>& todo_;
+        QAtomicInt& next_;
+        QAtomicInt& best_;
+        ConstNoteIterator cni_;
+        Fingering force_first_;
+        const Note *lead_in_;
+        const unsigned int *notes_left_;
+    };
+
+    int Engine::chunkTotal(const ChunkCandidate& x)
+    {
+        int c = x.score.cost + x.position_cost;
+        if (x.fresh && (x.score.length == 1)) {
+            /*
+             * Don't allow the bonuses for low positions to fool us
+             * into accepting a rubbishy one-note segment.
+             */
+            c += engine_single_note_penalty;
+        }
+        return c;
+    }
+
+    void Engine::offerBest(QAtomicInt& best, int total)
+    {
+        int b = best.loadAcquire();
+        while ((total < b) && !best.testAndSetOrdered(b, total)) {
+            b = best.loadAcquire();
+        }
+    }
+
+    void Engine::generateChunks(Segment& seg,
+                                std::vector<ChunkCandidate>& candidates,
+                                ConstNoteIterator cni,
+                                unsigned int cni_index,
+                                const Fingering& force_first,
+                                const Note *lead_in,
+                                const unsigned int *notes_left)
     {
-#ifdef EXTRA_DEBUG
-        qDebug("Engine::compute");
-#endif
-        int pass_num = 0;
         /*
-         * Take a copy of the input list, for autohint insertion.
-         * 
-         * QValueList is implicitly shared, so this is ok
+         * Best total cost so far. Cached chunks come for free, so they set
+         * the first bound for the rest.
          */
-        source_note_list_ = source_notelist;
-        
-#ifdef EXTRA_DEBUG
-        dbgDumpNoteList(source_notelist);
-#endif
+        QAtomicInt best(engine_no_chunk_cost);
+
+        /*
+         * The key covers everything generateChunk() looks at, except for
+         * the hints on the notes themselves. Those are dealt with by
+         * invalidateChunkCache() when hints change.
+         */
+        seg.stats.chunk_candidates += candidates.size();
+
+        std::vector<ChunkCandidate*> todo;
+        for (std::vector<ChunkCandidate>::iterator x = candidates.begin();
+                x != candidates.end();
+                ++x)
+        {
+            (*x).key.note = cni_index;
+            (*x).key.position = (*x).position;
+            (*x).key.start = (*x).start;
+            (*x).key.force_finger = force_first.finger;
+            if (lead_in != 0) {
+                (*x).key.lead_in = lead_in->fingering();
+            }
+
+            ChunkCache::const_iterator i = seg.chunk_cache.find((*x).key);
+            if (i != seg.chunk_cache.end()) {
+                ++seg.stats.chunk_cache_hits;
+                (*x).score = (*i).second;
+                offerBest(best, chunkTotal(*x));
+            }
+            else {
+                ++seg.stats.chunk_cache_misses;
+                todo.push_back(&(*x));
+            }
+        }
+
+        if (seg.threaded && (threads_ > 1) && (todo.size() > 1)) {
+            if (pool_ == 0) {
+                pool_ = new QThreadPool;
+                pool_->setMaxThreadCount(threads_ - 1);
+            }
+
+            /*
+             * This thread joins in too, rather than waiting idle.
+             */
+            QAtomicInt next(0);
+            unsigned int helpers = qMin((unsigned int) threads_ - 1, (unsigned int) todo.size() - 1);
+            for (unsigned int i = 0; i < helpers; ++i) {
+                pool_->start(new ChunkWorker(algorithm_, todo, next, best, cni, force_first, lead_in, notes_left));
+            }
+            ChunkWorker(algorithm_, todo, next, best, cni, force_first, lead_in, notes_left).run();
+            pool_->waitForDone();
+        }
+        else {
+            QAtomicInt next(0);
+            ChunkWorker(algorithm_, todo, next, best, cni, force_first, lead_in, notes_left).run();
+        }
+
+        /*
+         * A pruned score depends on the bound, so it can't be re-used.
+         */
+        for (std::vector<ChunkCandidate*>::iterator x = todo.begin();
+                x != todo.end();
+                ++x)
+        {
+            if (!(**x).score.pruned) {
+                std::pair<ChunkCache::iterator, bool> i = seg.chunk_cache.insert(std::make_pair((**x).key, (**x).score));
+                if (i.second) {
+                    seg.chunk_cache_ends.insert(std::make_pair((**x).key.note + (**x).score.length, i.first));
+                }
+            }
+            else {
+                ++seg.stats.chunks_pruned;
+            }
+        }
+    }
+
+    void Engine::invalidateChunkCache(Segment& seg, unsigned int first_changed)
+    {
+        /*
+         * A chunk depends on the notes it covers, plus the note after it
+         * (which stopped it.)
+         */
+        ChunkCacheEnds::iterator first = seg.chunk_cache_ends.lower_bound(first_changed);
+        for (ChunkCacheEnds::iterator i = first; i != seg.chunk_cache_ends.end(); ++i) {
+            seg.chunk_cache.erase((*i).second);
+        }
+        seg.chunk_cache_ends.erase(first, seg.chunk_cache_ends.end());
+    }
+
+    /*!
+     * \brief Count the notes from each note up to the next position break,
+     * for bounding the cost of chunks.
+     *
+     * Only the hints on the notes from first_changed to last_changed have
+     * changed since notes_left was last counted, so the counts after those
+     * stand, and those before stand from the first that comes out the same.
+     */
+    void Engine::countNotesLeft(const NoteList& source, std::vector<unsigned int>& notes_left,
+                                unsigned int first_changed, unsigned int last_changed)
+    {
+        notes_left.resize(source.size() + 1, 0);
+        for (unsigned int i = qMin(last_changed + 1, (unsigned int) source.size()); i-- > 0; ) {
+            const Note& n = source[i];
+            unsigned int count;
+            if (n.noteNum() == NotDefined) {
+                count = 0;
+            }
+            else if (n.isRest()) {
+                count = notes_left[i + 1];
+            }
+            else if (n.hasBreakHint()) {
+                count = 0;
+            }
+            else {
+                count = notes_left[i + 1] + 1;
+            }
+            if ((i < first_changed) && (count == notes_left[i])) {
+                break;
+            }
+            notes_left[i] = count;
+        }
+    }
+
+    bool Engine::compute(const NoteList& source_notelist, int max_pass)
+    {
+        if (tracing(TraceDebug)) {
+            qDebug("Engine::compute");
+            dbgDumpNoteList(source_notelist);
+        }
+        nlist_.clear();
+        diagrams_.clear();
+        stats_ = EngineStatistics();
+
         /*
          * Check that we have the necessary information
          */
@@ -123,44 +434,357 @@ namespace Holdsworth {
             return false;
         }
 
+        /*
+         * The same notes with the same settings always get the same
+         * fingering, so a result from the cache will do.
+         */
+        std::string key;
+        if (result_cache_ != 0) {
+            key = resultKey(source_notelist, max_pass);
+            CachedResult cached;
+            if (result_cache_->find(key, cached)) {
+                nlist_.swap(cached.output);
+                diagrams_.swap(cached.diagrams);
+                stats_.cost = cached.cost;
+                stats_.shifts = cached.shifts;
+                stats_.result_cache_hits = 1;
+                return true;
+            }
+        }
+
+        /*
+         * Take a copy of the input list, for autohint insertion. If we are
+         * allowed to, split it at the restart ("=") hints; the lead-in note
+         * is ignored there anyway, so each part can be fingered on its own.
+         */
+        std::vector<Segment> segments(1);
+        for (ConstNoteIterator ni = source_notelist.begin(); ni != source_notelist.end(); ++ni) {
+            if (split_segments_
+                    && (*ni).hasRestartHint()
+                    && !(*ni).isRest()
+                    && ((*ni).noteNum() != NotDefined)
+                    && !segments.back().source.empty()) {
+                segments.back().source.push_back(Note(NotDefined));
+                segments.push_back(Segment());
+            }
+            segments.back().source.push_back(*ni);
+        }
+        stats_.segments = segments.size();
+
+        if (segments.size() == 1) {
+            segments[0].threaded = true;
+            segments[0].progress = progress_;
+            segments[0].ok = computeSegment(segments[0], max_pass);
+        }
+        else {
+            if (progress_) {
+                TRACE(TraceProgress) << segments.size() << " segments: ";
+            }
+
+            QThreadPool pool;
+            if (threads_ > 1) {
+                pool.setMaxThreadCount(threads_);
+            }
+            for (std::vector<Segment>::iterator seg = segments.begin(); seg != segments.end(); ++seg) {
+                (*seg).progress = false;
+                pool.start(new SegmentWorker(this, *seg, max_pass));
+            }
+            pool.waitForDone();
+
+            if (progress_) {
+                TRACE(TraceProgress) << " Done." << std::endl;
+            }
+        }
+
+        /*
+         * Stitch the results back together.
+         */
+        FingerPosition last_fp = NotDefined;
+        for (std::vector<Segment>::iterator seg = segments.begin(); seg != segments.end(); ++seg) {
+            if (!(*seg).ok) {
+                nlist_.clear();
+                diagrams_.clear();
+                return false;
+            }
+
+            if ((*seg).first_fp != NotDefined) {
+                if ((last_fp != NotDefined) && (last_fp != (*seg).first_fp) && !(*seg).output.empty()) {
+                    /*
+                     * Same as Chunk::tagPositionShift()
+                     */
+                    Note& n = (*seg).output.front();
+                    if (!n.hasAnnotation(HINT_SHIFT_UP) && !n.hasAnnotation(HINT_SHIFT_DOWN)) {
+                        n.addAnnotation(ANNO_SHIFT);
+                    }
+                    ++stats_.shifts;
+                }
+                last_fp = (*seg).last_fp;
+            }
+
+            for (FretDiagramMap::const_iterator d = (*seg).diagrams.begin(); d != (*seg).diagrams.end(); ++d) {
+                diagrams_[nlist_.size() + (*d).first] = (*d).second;
+            }
+            nlist_.insert(nlist_.end(), (*seg).output.begin(), (*seg).output.end());
+
+            stats_ += (*seg).stats;
+        }
+
+        if (result_cache_ != 0) {
+            CachedResult result;
+            result.output = nlist_;
+            result.diagrams = diagrams_;
+            result.cost = stats_.cost;
+            result.shifts = stats_.shifts;
+            result_cache_->insert(key, result);
+        }
+        return true;
+    }
+
+    static void hashInt(QCryptographicHash& hash, qint32 x)
+    {
+        const char b[4] = { (char) x, (char) (x >> 8), (char) (x >> 16), (char) (x >> 24) };
+        hash.addData(b, 4);
+    }
+
+    static void hashName(QCryptographicHash& hash, const char *name)
+    {
+        hash.addData(name, qstrlen(name) + 1);
+    }
+
+    /*!
+     * \brief The key for the result of compute() in the ResultCache.
+     *
+     * Everything is hashed a field at a time, in a fixed byte order, so
+     * the key doesn't depend on how the structures are laid out.
+     */
+    std::string Engine::resultKey(const NoteList& source_notelist, int max_pass) const
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+
+        /*
+         * Subclasses may cost things differently.
+         */
+        hashName(hash, typeid(*this).name());
+        hashName(hash, typeid(*algorithm_).name());
+        hashName(hash, typeid(*constraints_).name());
+        hashName(hash, typeid(*instrument_).name());
+
+        const CostWeights& w = algorithm_->costWeights();
+        hashInt(hash, w.note_bonus);
+        hashInt(hash, w.position_break_threshold);
+        hashInt(hash, w.string_change);
+        hashInt(hash, w.q_shift_penalty);
+        hashInt(hash, w.t_move_penalty);
+        hashInt(hash, w.layover_penalty);
+        hashInt(hash, w.o_move_penalty);
+        hashInt(hash, w.a_move_penalty);
+        hashInt(hash, w.bad_pos_change_penalty);
+        hashInt(hash, w.pinky_penalty);
+        hashInt(hash, w.index_stretch_penalty);
+        hashInt(hash, w.pinky_stretch_penalty);
+        hashInt(hash, w.auto_hint_giveup_size);
+
+        hashInt(hash, constraints_->getBTBGliss());
+
+        const InstrumentStringList& strings = instrument_->strings();
+        hashInt(hash, strings.size());
+        for (InstrumentStringList::const_iterator i = strings.begin(); i != strings.end(); ++i) {
+            hashInt(hash, (*i).basenote);
+            hashInt(hash, (*i).num_frets);
+        }
+
+        hashInt(hash, max_lh_shift);
+        hashInt(hash, search_mode_);
+        hashInt(hash, split_segments_);
+        hashInt(hash, max_pass);
+
+        hashInt(hash, source_notelist.size());
+        for (ConstNoteIterator ni = source_notelist.begin(); ni != source_notelist.end(); ++ni) {
+            hashInt(hash, (*ni).noteNum());
+            hashInt(hash, (*ni).duration());
+            hashInt(hash, (*ni).time());
+            hashInt(hash, (*ni).stringNum());
+            hashInt(hash, (*ni).fretNum());
+            hashInt(hash, (*ni).fingerNum());
+            hashInt(hash, (*ni).annotation());
+        }
+
+        return hash.result().toHex().constData();
+    }
+
+    bool Engine::computeScore(std::vector<ScorePart>& score, int max_pass)
+    {
+        nlist_.clear();
+        diagrams_.clear();
+        stats_ = EngineStatistics();
+
+        /*
+         * Each part gets an engine of its own, sharing this one's
+         * instrument, algorithm and constraints, which are not changed by
+         * fingering.
+         */
+        std::vector<Engine*> engines;
+        for (unsigned int i = 0; i < score.size(); ++i) {
+            Engine *e = new Engine;
+            e->instrument_ = instrument_;
+            e->constraints_ = constraints_;
+            e->algorithm_ = algorithm_;
+            e->max_lh_shift = max_lh_shift;
+            e->search_mode_ = search_mode_;
+            e->split_segments_ = split_segments_;
+            e->result_cache_ = result_cache_;
+            engines.push_back(e);
+        }
+
+        if (score.size() == 1) {
+            engines[0]->threads_ = threads_;
+            engines[0]->progress_ = progress_;
+            PartWorker(engines[0], score[0], max_pass).run();
+        }
+        else {
+            if (progress_) {
+                TRACE(TraceProgress) << score.size() << " parts: ";
+            }
+
+            QThreadPool pool;
+            if (threads_ > 1) {
+                pool.setMaxThreadCount(threads_);
+            }
+            for (unsigned int i = 0; i < score.size(); ++i) {
+                engines[i]->progress_ = false;
+                pool.start(new PartWorker(engines[i], score[i], max_pass));
+            }
+            pool.waitForDone();
+
+            if (progress_) {
+                TRACE(TraceProgress) << " Done." << std::endl;
+            }
+        }
+
+        bool ok = true;
+        for (unsigned int i = 0; i < score.size(); ++i) {
+            delete engines[i];
+            if (!score[i].ok) {
+                ok = false;
+            }
+            stats_ += score[i].stats;
+            stats_.segments += score[i].stats.segments;
+        }
+        return ok;
+    }
+
+    bool Engine::computeSegment(Segment& seg, int max_pass)
+    {
+        if (search_mode_ == GlobalSearch) {
+            return computeGlobal(seg);
+        }
+        else {
+            return computeChunks(seg, max_pass);
+        }
+    }
+
+    bool Engine::computeChunks(Segment& seg, int max_pass)
+    {
+        int pass_num = 0;
+        const unsigned int giveup_size = algorithm_->costWeights().auto_hint_giveup_size;
+
+        /*
+         * Chunk boundaries reached in the previous pass, so that the next
+         * pass can pick up from just before its new hint.
+         */
+        std::vector<Checkpoint> checkpoints;
+        unsigned int first_changed = 0;
+
+        std::vector<unsigned int> notes_left;
+        countNotesLeft(seg.source, notes_left, 0, seg.source.size());
+
         do {
-            OUTPUT << "Pass: " << ++pass_num << ": ";
-            /*
-             * Clear out any old notelist
-             */
-            nlist_.clear();
+            ++pass_num;
+            OUTPUT(seg) << "Pass: " << pass_num << ": ";
 
-            /*
-             * Start from the first note in the list
-             */
-            ConstNoteIterator cni = source_note_list_.begin();
-            while (cni != source_note_list_.end() && ((*cni).noteNum() != NotDefined) && ((*cni).noteNum() == 0)) {
-                /* Pass through initial rests in pick-up bar */
-                Note n;
-                n.setDuration((*cni).duration());
+            ConstNoteIterator cni;
+            unsigned int cni_index;
+            ConstNoteIterator start_of_last_chunk;
+            FingerPosition  last_fp;
+            unsigned int reach;
 
-                nlist_.push_back(n);
+            if (checkpoints.empty()) {
+                /*
+                 * Clear out any old notelist
+                 */
+                seg.output.clear();
+                seg.diagrams.clear();
+                seg.stats.cost = 0;
+                seg.stats.shifts = 0;
 
                 /*
-                 * ...and onto the next note
+                 * Start from the first note in the list
                  */
-                ++cni;
-            }
+                cni = seg.source.begin();
+                cni_index = 0;
+                while (cni != seg.source.end() && ((*cni).noteNum() != NotDefined) && ((*cni).noteNum() == 0)) {
+                    /* Pass through initial rests in pick-up bar */
+                    Note n;
+                    n.setDuration((*cni).duration());
 
-            ConstNoteIterator start_of_last_chunk = cni;
+                    seg.output.push_back(n);
 
-            FingerPosition  last_fp = NotDefined;
+                    /*
+                     * ...and onto the next note
+                     */
+                    ++cni;
+                    ++cni_index;
+                }
 
-            hint_type_ = ANNO_NONE;
+                start_of_last_chunk = cni;
+                last_fp = NotDefined;
+                reach = 0;
+            }
+            else {
+                /*
+                 * Everything decided before the last checkpoint that never
+                 * looked as far as the new hint still stands.
+                 */
+                unsigned int k = checkpoints.size() - 1;
+                while ((k > 0) && (checkpoints[k].reach > first_changed)) {
+                    --k;
+                }
+                const Checkpoint& cp = checkpoints[k];
+                cni = cp.note;
+                cni_index = cp.note_index;
+                start_of_last_chunk = cp.start_of_last_chunk;
+                last_fp = cp.last_fp;
+                reach = cp.reach;
+                seg.output.resize(cp.output_length);
+                seg.stats.cost = cp.cost;
+                seg.stats.shifts = cp.shifts;
+                seg.diagrams.erase(seg.diagrams.lower_bound(cp.output_length), seg.diagrams.end());
+                checkpoints.resize(k);
+                OUTPUT(seg) << "@" << cni_index << " ";
+            }
 
-            while (cni != source_note_list_.end() && ((*cni).noteNum() != NotDefined)) {
-                int last_cost = 1000000L;
-                Chunk bestchunk;
+            seg.hint_type = ANNO_NONE;
+            seg.hint_locations.clear();
+
+            while (cni != seg.source.end() && ((*cni).noteNum() != NotDefined)) {
+                Checkpoint cp;
+                cp.note = cni;
+                cp.note_index = cni_index;
+                cp.start_of_last_chunk = start_of_last_chunk;
+                cp.last_fp = last_fp;
+                cp.output_length = seg.output.size();
+                cp.cost = seg.stats.cost;
+                cp.shifts = seg.stats.shifts;
+                cp.reach = reach;
+                checkpoints.push_back(cp);
+
+                int last_cost = engine_no_chunk_cost;
+                int best = NotDefined;
 
                 /*
                  * Locate possible positions for this note on the fretboard
                  */
-                FretPosList fpcandidates = instrument_->candidates(*cni);
+                const FretPosList& fpcandidates = instrument_->candidates(*cni);
 
                 if (fpcandidates.empty()) {
                     qDebug("No possible starting position!");
@@ -170,8 +794,8 @@ namespace Holdsworth {
                 Fingering cf = (*cni).fingering();
                 const Note *lead_in_note = 0;
 
-                if (cni != source_note_list_.begin()) {
-                    lead_in_note = &nlist_.back();
+                if (cni != seg.source.begin()) {
+                    lead_in_note = &seg.output.back();
                     if (cf.hasAnnotation(HINT_GLISS)) {
                         cf.finger = lead_in_note->fingerNum();
                         cf.strg = lead_in_note->stringNum();
@@ -187,6 +811,7 @@ namespace Holdsworth {
                 /*
                  * For each possible starting position...
                  */
+                std::vector<ChunkCandidate> candidates;
                 for (FretPosList::const_iterator fp = fpcandidates.begin();
                         fp != fpcandidates.end();
                         ++fp)
@@ -195,15 +820,13 @@ namespace Holdsworth {
                      * Has the string been mandated?
                      */
                     if ((cf.strg != NotDefined) && (cf.strg != (*fp).strg)) {
-#ifdef EXTRA_DEBUG
-                        qDebug("Auto-string for chunk start overridden by input hint");
-#endif
+                        TRACE(TraceDebug) << "Auto-string for chunk start overridden by input hint" << std::endl;
                         continue;
                     }
                     /*
                      * Locate the possible corresponding starting LH position
                      */
-                    FingerPositionList pcandidates = algorithm_->candidates(*fp);
+                    const FingerPositionList& pcandidates = algorithm_->candidates(*fp);
                     
                     /*
                      * For each of these possible LH positions....
@@ -212,96 +835,78 @@ namespace Holdsworth {
                             p != pcandidates.end();
                             ++p)
                     {
-                        /*
-                         * Generate a fingering chunk
-                         */
-                        Chunk c = algorithm_->generateChunk(ConstNoteIterator(cni), *p, *fp, cf, lead_in_note);
-#ifdef SOME_DEBUG
-                        qDebug("Chunk @%d cost = %d", c.getPosition(), c.cost());
-#endif
-
-                        if ((last_fp != NotDefined) && (lead_in_note != 0)) {
-                            if ((*cni).hasAnnotation(HINT_SHIFT_UP)) {
-                                c.addCost(hintUpCost(last_fp, *p));
-                            }
-                            else if ((*cni).hasAnnotation(HINT_SHIFT_DOWN)) {
-                                c.addCost(hintDownCost(last_fp, *p));
-                            }
-                            else {
-                                /*
-                                 * Add a penalty for large position skips.
-                                 * In other words, if two starting positions yield similar
-                                 * results, then the one that involves the smaller movement
-                                 * from the last position is better.
-                                 */
-                                c.addCost(absolute_diff(*p, last_fp));
-                            }
+                        if (!algorithm_->acceptsStart(*p, *fp, cf)) {
+                            continue;
                         }
-                        else {
-                            if ((*cni).hasAnnotation(HINT_SHIFT_UP)) {
-                                c.addCost(hintUpCost(*p));
-                            }
-                            else if ((*cni).hasAnnotation(HINT_SHIFT_DOWN)) {
-                                c.addCost(hintDownCost(*p));
-                            }
-                            else {
-                                /*
-                                 * Prefer a lower position, but don't be silly about it.
-                                 */
-                                if (*p > 7) {
-                                    c.addCost(*p - 7);
-                                }
-                                if (*p < 5) {
-                                    c.addCost(5 - *p);
-                                }
-                            }
 
-                            if (c.length() == 1) {
-                                /*
-                                 * Don't allow the bonuses for low positions to fool us
-                                 * into accepting a rubbishy one-note segment.
-                                 */
-                                c.addCost(5); //TODO
-                            }
+                        ChunkCandidate x;
+                        x.start = *fp;
+                        x.position = *p;
+                        x.fresh = (last_fp == NotDefined) || (lead_in_note == 0);
+                        x.position_cost = positionCost(*cni, x.fresh ? NotDefined : last_fp, *p);
+                        candidates.push_back(x);
+                    }
+                }
 
-                        }
-#ifdef SOME_DEBUG
-                        qDebug("Added position cost, final = %d", c.cost());
-#endif
-                        if ((c.cost() < last_cost) 
-                            || ((c.cost() == last_cost) && (c.length() > bestchunk.length()))) {
-                            last_cost = c.cost();
-#ifdef SOME_DEBUG
-                            qDebug("We have a new best chunk with cost %d!!!", last_cost);
-#endif
-                            bestchunk = c;
-                        }
-#ifdef EXTRA_DEBUG
-                        qDebug("===================\n\n");
-#endif
+                /*
+                 * Score a fingering chunk for each
+                 */
+                generateChunks(seg, candidates, cni, cni_index, cf, lead_in_note, &notes_left[cni_index]);
+
+                /*
+                 * ...and pick the best. Ties go to the longest chunk, and then
+                 * to the first one found.
+                 */
+                for (std::vector<ChunkCandidate>::iterator x = candidates.begin();
+                        x != candidates.end();
+                        ++x)
+                {
+                    const ChunkScore& c = (*x).score;
+                    if (cni_index + c.length + 1 > reach) {
+                        /* The note after the chunk was looked at too */
+                        reach = cni_index + c.length + 1;
+                    }
+                    if (c.pruned) {
+                        /* It couldn't have won */
+                        continue;
+                    }
+
+                    int total = chunkTotal(*x);
+                    TRACE(TraceDetail) << "Chunk @" << (*x).position << " cost = " << c.cost
+                        << ", with position cost = " << total << std::endl;
+                    if ((total < last_cost) 
+                        || ((total == last_cost) && (c.length > ((best == NotDefined) ? 0U : candidates[best].score.length)))) {
+                        last_cost = total;
+                        TRACE(TraceDetail) << "We have a new best chunk with cost " << last_cost << std::endl;
+                        best = x - candidates.begin();
                     }
                 }
 
                 /*
-                 * Append the best chunk
+                 * Build the best chunk, and append it
                  */
-#ifdef EXTRA_DEBUG
-                qDebug("Adding %d notes from best chunk with score %d", bestchunk.length(), bestchunk.cost());
-                bestchunk.dbgDump();
-#endif
+                Chunk bestchunk;
+                if (best != NotDefined) {
+                    bestchunk = algorithm_->generateChunk(cni, candidates[best].position, candidates[best].start, cf, lead_in_note);
+                    ++seg.stats.chunks_generated;
+                }
+                TRACE(TraceDetail) << "Adding " << bestchunk.length() << " notes from best chunk with score " << last_cost << std::endl;
+                if (tracing(TraceDebug)) {
+                    bestchunk.dbgDump();
+                }
                 bestchunk.makeFretDiag();
                 
                 if ((*cni).hasRestartHint()) {
-                    OUTPUT << " ";
+                    OUTPUT(seg) << " ";
                 }
                 FingerPosition bp = bestchunk.getPosition();
-                OUTPUT << "[" << bp << "]";
+                OUTPUT(seg) << "[" << bp << "]";
                 /*
                  * It is possible that the best chunk represents a big position skip
                  * from the previous chunk. This can indicate a "maximum munch" problem
                  * wherein the previous chunk over-milked a position.
                  */
-                if ((last_fp != NotDefined) && (last_fp != bp) && (hint_type_ == ANNO_NONE)) {
+                if ((last_fp != NotDefined) && (last_fp != bp) && (seg.hint_type == ANNO_NONE)) {
                     int pdiff = absolute_diff(last_fp, bp);
 
                     if (
@@ -309,30 +914,28 @@ namespace Holdsworth {
                         ||
                         (!constraints_->getBTBGliss() && (bestchunk.length() == 1) && (!(*cni).hasGlissHint()))
                     ) {
-                        OUTPUT << "<" << pdiff << ">";
-#ifdef EXTRA_DEBUG
-                        qDebug("***Excessive LH shift - try finding shift hint locations ***");
-#endif
+                        OUTPUT(seg) << "<" << pdiff << ">";
+                        TRACE(TraceDetail) << "Excessive LH shift - try finding shift hint locations" << std::endl;
                         if (last_fp > bp) {
-                            hint_type_ = HINT_SHIFT_DOWN;
+                            seg.hint_type = HINT_SHIFT_DOWN;
                         }
                         else {
-                            hint_type_ = HINT_SHIFT_UP;
+                            seg.hint_type = HINT_SHIFT_UP;
                         }
                             
                         bool lever_chunk_start = false;
 
-                        if (start_of_last_chunk == source_note_list_.begin()) {
+                        if (start_of_last_chunk == seg.source.begin()) {
                             if (!(*start_of_last_chunk).hasShiftHint()) {
-                                OUTPUT << "<liststart>";
-                                hint_location_ = start_of_last_chunk;
+                                OUTPUT(seg) << "<liststart>";
+                                seg.hint_locations.push_back(start_of_last_chunk);
                                 lever_chunk_start = true;
                             }
                         }
                         else if ((*start_of_last_chunk).hasRestartHint()) {
                             if (!(*start_of_last_chunk).hasShiftHint()) {
-                                OUTPUT << "<chunkstart>";
-                                hint_location_ = start_of_last_chunk;
+                                OUTPUT(seg) << "<chunkstart>";
+                                seg.hint_locations.push_back(start_of_last_chunk);
                                 lever_chunk_start = true;
                             }
                         }
@@ -342,7 +945,7 @@ namespace Holdsworth {
                              * If there is a small jump, don't use shift hints, they do more harm than good.
                              */
                             if (pdiff < 5) {
-                                hint_type_ = HINT_BREAK;
+                                seg.hint_type = HINT_BREAK;
                             }
                             /*
                              * Pass 1 - determine note range of previous chunk
@@ -350,9 +953,7 @@ namespace Holdsworth {
                             NoteNum lowest_note = 10000;
                             NoteNum highest_note = 0;
                             uint note_count = 0;
-                            //QT4: we can do ni = cni - 1
-                            ConstNoteIterator ni = cni;
-                            --ni;
+                            ConstNoteIterator ni = cni - 1;
                                 
                             for (; ni != start_of_last_chunk; --ni) {
                                 if ((*ni).noteNum() < lowest_note) {
@@ -366,79 +967,73 @@ namespace Holdsworth {
 
                             NoteNum threshold_note = (lowest_note + highest_note) / 2;
                             if (pdiff == 5) {
-                                //OUTPUT << "{" << note_count << "/" << highest_note - lowest_note << "}";  
+                                //OUTPUT(seg) << "{" << note_count << "/" << highest_note - lowest_note << "}";  
                                 if ((highest_note > lowest_note)) {
                                     if ((note_count / (highest_note - lowest_note)) < 2) {
-                                        hint_type_ = HINT_BREAK;
+                                        seg.hint_type = HINT_BREAK;
                                     }
                                 }
                             }
 
-                            if (hint_type_ == HINT_SHIFT_UP) {
-                                OUTPUT << "+";
+                            if (seg.hint_type == HINT_SHIFT_UP) {
+                                OUTPUT(seg) << "+";
                             }
-                            else if (hint_type_ == HINT_SHIFT_DOWN) {
-                                OUTPUT << "-";
+                            else if (seg.hint_type == HINT_SHIFT_DOWN) {
+                                OUTPUT(seg) << "-";
                             }
-                            else if (hint_type_ == HINT_BREAK) {
-                                OUTPUT << "*";
+                            else if (seg.hint_type == HINT_BREAK) {
+                                OUTPUT(seg) << "*";
                             }
 
-                            if (note_count < engine_auto_hint_giveup_size) {
-                                OUTPUT << "!";
-                                hint_type_ = ANNO_NONE;
-#ifdef EXTRA_DEBUG
-                                qDebug("Tough, this looks like a genuine case of nasty shifts");
-#endif
+                            if (note_count < giveup_size) {
+                                OUTPUT(seg) << "!";
+                                seg.hint_type = ANNO_NONE;
+                                TRACE(TraceDetail) << "Tough, this looks like a genuine case of nasty shifts" << std::endl;
                             }
                             else {
-#ifdef EXTRA_DEBUG
-                                qDebug("Note range is %d to %d", lowest_note, highest_note);
-#endif
+                                TRACE(TraceDetail) << "Note range is " << lowest_note << " to " << highest_note << std::endl;
 
                                 /*
                                  * Pass 2 - determine location of hint
                                  */
-                                QList<ConstNoteIterator> crossing_points;
-                                ConstNoteIterator ni = cni;
-                                --ni;
+                                std::vector<ConstNoteIterator> crossing_points;
+                                ConstNoteIterator ni = cni - 1;
                                 int last_note = (*ni).noteNum();
                                 while (ni != start_of_last_chunk) {
                                     if (((*ni).noteNum() <= threshold_note) && (last_note > threshold_note)) {
-                                        if (hint_type_ != HINT_SHIFT_DOWN) {
-                                            crossing_points.append(ni);
+                                        if (seg.hint_type != HINT_SHIFT_DOWN) {
+                                            crossing_points.push_back(ni);
                                         }
                                     }
                                     else if (((*ni).noteNum() > threshold_note) && (last_note <= threshold_note)) {
-                                        if (hint_type_ != HINT_SHIFT_UP) {
-                                            crossing_points.append(ni);
+                                        if (seg.hint_type != HINT_SHIFT_UP) {
+                                            crossing_points.push_back(ni);
                                         }
                                     }
 
                                     last_note = (*ni).noteNum();
                                     --ni;
                                 }
-                                OUTPUT << "(" << crossing_points.count() << " crossings)";
+                                OUTPUT(seg) << "(" << crossing_points.size() << " crossings)";
 
-                                if (crossing_points.count() == 0) {
-                                    hint_type_ = ANNO_NONE;
+                                if (crossing_points.empty()) {
+                                    seg.hint_type = ANNO_NONE;
                                 }
-                                else if (note_count / crossing_points.count() < 4) {
-                                    hint_type_ = ANNO_NONE;
+                                else if (note_count / crossing_points.size() < 4) {
+                                    seg.hint_type = ANNO_NONE;
                                 }
                                 else {
-                                    ni = crossing_points[crossing_points.count() / 2];
+                                    /*
+                                     * Each hint can take out a shift of up to
+                                     * max_lh_shift, so a bigger jump needs
+                                     * several. Place them all now rather than
+                                     * one per pass. A max_lh_shift of 0 (any
+                                     * shift is too big) counts as 1 here.
+                                     */
+                                    int step = qMax(max_lh_shift, 1);
+                                    unsigned int hints = (pdiff + step - 1) / step - 1;
+                                    placeHints(seg, start_of_last_chunk, cni, crossing_points, qMax(hints, 1U));
                                 }
-
-                                hint_location_ = ni;
-                                ++hint_location_;
-                                if ((*hint_location_).isRest()) {
-                                    --hint_location_;
-                                }
-#ifdef EXTRA_DEBUG
-                                qDebug("Suggest Split at the note:-");
-                                qDebug((*hint_location_).dbgDump().c_str());
-#endif
                             }
                         }
                     }
@@ -449,26 +1044,24 @@ namespace Holdsworth {
                  */
                 if (last_fp == NotDefined) {
                     last_fp = bp;
+                    seg.first_fp = bp;
                 }
                 else if (last_fp != bp) {
                     last_fp = bp;
                     bestchunk.tagPositionShift();
+                    ++seg.stats.shifts;
                 }
+                seg.last_fp = last_fp;
 
-		// std:list doesn't have the semantic sugar of += on lists. Hmph.
-		// The following is nlist_ += bestchunk.noteList().
-		
-		for (ConstNoteIterator foobar = bestchunk.noteList().begin();
-		      foobar != bestchunk.noteList().end();
-		      ++foobar
-		) {
-		    nlist_.push_back(*foobar);
-		}
+                if (best != NotDefined) {
+                    seg.stats.cost += last_cost;
+                }
+                appendChunk(seg, bestchunk);
 
                 if ((*cni).hasBreakHint()) {
                     start_of_last_chunk = cni;
                 }          
-                else if (bestchunk.length() > engine_auto_hint_giveup_size) {
+                else if (bestchunk.length() > giveup_size) {
                     start_of_last_chunk = cni;
                 }
 
@@ -476,47 +1069,681 @@ namespace Holdsworth {
                  * Skip past the chunked notes, making sure we don't go off the end of the list.
                  * Remember where this chunk started.
                  */
-                for (unsigned int i = 0; (i < bestchunk.length()) && (cni != source_note_list_.end()); ++i) {
-                    ++cni;
-                }
-#ifdef EXTRA_DEBUG
-                qDebug("-------------------------------\n\n");
-#endif
-
+                unsigned int skip = qMin((unsigned int) (seg.source.end() - cni), bestchunk.length());
+                cni += skip;
+                cni_index += skip;
                 /*
                  * Don't bother going further if we have hit a restart
                  * point and the notelist up to now already has a hint
                  * inserted.
                  */
-                if ((*cni).hasRestartHint() && (hint_type_ != ANNO_NONE)) {
+                if ((*cni).hasRestartHint() && (seg.hint_type != ANNO_NONE)) {
                     break;
                 }
             }
 
-            if (hint_type_ != ANNO_NONE) {
-                bool purge = false;
-                for (NoteList::iterator ni = source_note_list_.begin(); ni != source_note_list_.end(); ++ni) {
-                    if (ConstNoteIterator(ni) == hint_location_) {
-                        purge = true;
-                        (*ni).addAnnotation(hint_type_);
-                        (*ni).addAnnotation(ANNO_AUTOHINT);
-                    }
-                    else if (purge) {
+            if ((seg.hint_type != ANNO_NONE) && seg.hint_locations.empty()) {
+                seg.hint_type = ANNO_NONE;
+            }
+            if (seg.hint_type != ANNO_NONE) {
+                unsigned int index = seg.hint_locations.front() - seg.source.begin();
+                NoteList::iterator ni = seg.source.begin() + index;
+
+                /*
+                 * Hints only change from here on, so chunks that
+                 * finish before this note are still good.
+                 */
+                invalidateChunkCache(seg, index);
+                first_changed = index;
+
+                for (++ni; ni != seg.source.end(); ++ni) {
+                    if ((*ni).hasAnnotation(ANNO_AUTOHINT)) {
                         (*ni).purgeAutoHints();
-                        if ((*ni).hasRestartHint()) {
-                            purge = false;
+                        ++seg.stats.hints_purged;
+                    }
+                    if ((*ni).hasRestartHint()) {
+                        break;
+                    }
+                }
+                unsigned int last_changed = ni - seg.source.begin();
+
+                for (std::vector<ConstNoteIterator>::const_iterator h = seg.hint_locations.begin();
+                        h != seg.hint_locations.end();
+                        ++h)
+                {
+                    ni = seg.source.begin() + (*h - seg.source.begin());
+                    (*ni).addAnnotation(seg.hint_type);
+                    (*ni).addAnnotation(ANNO_AUTOHINT);
+                    ++seg.stats.hints_inserted;
+                    last_changed = qMax(last_changed, (unsigned int) (*h - seg.source.begin()));
+                }
+                countNotesLeft(seg.source, notes_left, first_changed, last_changed);
+            }
+            OUTPUT(seg) << " Done." << std::endl;
+
+        } while ((seg.hint_type != ANNO_NONE) && (pass_num < max_pass));
+
+        seg.stats.passes = pass_num;
+        return true;
+    }
+
+    /*!
+     * \brief Choose where to put the given number of hints in the notes from
+     * first up to end, which the previous chunk played in one position.
+     *
+     * The hints go just after some of the crossing points, which are in
+     * reverse order, as found by computeChunks(). A single hint goes after
+     * the middle crossing point, as it always has.
+     *
+     * For more than one, the cuts are chosen to minimise the largest note
+     * range (highest note less lowest, in semitones) of the pieces they
+     * leave, so each piece has the best chance of fitting under the hand in
+     * a position of its own. That is a stand-in for the shift cost, which
+     * isn't known until the pieces have been fingered.
+     */
+    void Engine::placeHints(Segment& seg, ConstNoteIterator first, ConstNoteIterator end, const std::vector<ConstNoteIterator>& crossing_points, unsigned int hints)
+    {
+        hints = qMin(hints, (unsigned int) crossing_points.size());
+        if (hints <= 1) {
+            ConstNoteIterator location = crossing_points[crossing_points.size() / 2];
+            ++location;
+            if ((*location).isRest()) {
+                --location;
+            }
+            seg.hint_locations.push_back(location);
+            TRACE(TraceDetail) << "Suggest split at the note: " << (*location).dbgDump() << std::endl;
+            return;
+        }
+
+        /*
+         * The places the notes can be cut, in order, with the ends of the
+         * range either side of them.
+         */
+        std::vector<ConstNoteIterator> cuts;
+        cuts.push_back(first);
+        for (unsigned int i = crossing_points.size(); i-- > 0; ) {
+            cuts.push_back(crossing_points[i] + 1);
+        }
+        cuts.push_back(end);
+
+        unsigned int num_cuts = cuts.size();
+
+        /*
+         * span[i][j] is the note range of the piece from cut i to cut j.
+         */
+        std::vector<std::vector<int> > span(num_cuts, std::vector<int>(num_cuts, 0));
+        for (unsigned int i = 0; i < num_cuts - 1; ++i) {
+            NoteNum lowest_note = 10000;
+            NoteNum highest_note = 0;
+            unsigned int j = i + 1;
+            for (ConstNoteIterator ni = cuts[i]; ni != end; ++ni) {
+                if (ni == cuts[j]) {
+                    span[i][j] = (highest_note > lowest_note) ? (highest_note - lowest_note) : 0;
+                    ++j;
+                }
+                if (!(*ni).isRest()) {
+                    lowest_note = qMin(lowest_note, (*ni).noteNum());
+                    highest_note = qMax(highest_note, (*ni).noteNum());
+                }
+            }
+            span[i][num_cuts - 1] = (highest_note > lowest_note) ? (highest_note - lowest_note) : 0;
+        }
+
+        /*
+         * widest[h][j] is the narrowest that the widest piece up to cut j
+         * can be, with h hints of which the last is at cut j.
+         */
+        const int unreachable = engine_no_chunk_cost;
+        std::vector<std::vector<int> > widest(hints + 1, std::vector<int>(num_cuts, unreachable));
+        std::vector<std::vector<unsigned int> > from(hints + 1, std::vector<unsigned int>(num_cuts, 0));
+        widest[0][0] = 0;
+        for (unsigned int h = 1; h <= hints; ++h) {
+            for (unsigned int j = h; j < num_cuts - 1; ++j) {
+                for (unsigned int i = h - 1; i < j; ++i) {
+                    if (widest[h - 1][i] == unreachable) {
+                        continue;
+                    }
+                    int w = qMax(widest[h - 1][i], span[i][j]);
+                    if (w < widest[h][j]) {
+                        widest[h][j] = w;
+                        from[h][j] = i;
+                    }
+                }
+            }
+        }
+
+        int best_width = unreachable;
+        unsigned int last = 0;
+        for (unsigned int j = hints; j < num_cuts - 1; ++j) {
+            if (widest[hints][j] == unreachable) {
+                continue;
+            }
+            int w = qMax(widest[hints][j], span[j][num_cuts - 1]);
+            if (w < best_width) {
+                best_width = w;
+                last = j;
+            }
+        }
+
+        seg.hint_locations.resize(hints);
+        for (unsigned int h = hints; h > 0; --h) {
+            ConstNoteIterator location = cuts[last];
+            if ((*location).isRest()) {
+                --location;
+            }
+            seg.hint_locations[h - 1] = location;
+            TRACE(TraceDetail) << "Suggest split at the note: " << (*location).dbgDump() << std::endl;
+            last = from[h][last];
+        }
+    }
+
+    bool Engine::computeGlobal(Segment& seg)
+    {
+        OUTPUT(seg) << "Global search: ";
+        seg.stats.passes = 1;
+        seg.output.clear();
+        seg.diagrams.clear();
+        seg.layers.clear();
+
+        ConstNoteIterator cni = seg.source.begin();
+        while (cni != seg.source.end() && ((*cni).noteNum() != NotDefined) && ((*cni).noteNum() == 0)) {
+            /* Pass through initial rests in pick-up bar */
+            Note n;
+            n.setDuration((*cni).duration());
+
+            seg.output.push_back(n);
+            ++cni;
+        }
+
+        ConstNoteIterator first_note = cni;
+
+        for (; cni != seg.source.end() && ((*cni).noteNum() != NotDefined); ++cni) {
+            if (!extendSearch(seg.layers, *cni)) {
+                qDebug("No possible fingering for note %d!", (*cni).noteNum());
+                return false;
+            }
+            seg.stats.search_states += seg.layers.back().states.size();
+        }
+        OUTPUT(seg) << seg.layers.size() << " notes";
+
+        if (seg.layers.empty()) {
+            OUTPUT(seg) << " Done." << std::endl;
+            return true;
+        }
+
+        /*
+         * Trace the cheapest path back from the last note.
+         */
+        std::vector<int> path(seg.layers.size());
+        const std::vector<SearchState>& last_states = seg.layers.back().states;
+        /*
+         * Ending on a one-note chunk is judged as extendSearch() judges
+         * one in the middle.
+         */
+        bool avoid_btb = false;
+        if (!constraints_->getBTBGliss()) {
+            for (unsigned int i = 0; i < last_states.size(); ++i) {
+                if (!last_states[i].jumped) {
+                    avoid_btb = true;
+                }
+            }
+        }
+        int k = NotDefined;
+        int best_cost = 0;
+        for (unsigned int i = 0; i < last_states.size(); ++i) {
+            if (avoid_btb && last_states[i].jumped) {
+                continue;
+            }
+            int c = last_states[i].cost + (last_states[i].fresh ? engine_single_note_penalty : 0);
+            if ((k == NotDefined) || (c < best_cost)) {
+                k = i;
+                best_cost = c;
+            }
+        }
+        seg.stats.cost = best_cost;
+        for (int l = seg.layers.size() - 1; l >= 0; --l) {
+            path[l] = k;
+            k = seg.layers[l].states[k].back;
+        }
+
+        /*
+         * Rebuild the path as a sequence of chunks, so that the output
+         * is annotated in the same way as for a chunk search.
+         */
+        FingerPosition last_fp = NotDefined;
+        Chunk chunk;
+        cni = first_note;
+        for (unsigned int l = 0; l <= seg.layers.size(); ++l, ++cni) {
+            const SearchState *s = 0;
+            if (l < seg.layers.size()) {
+                s = &seg.layers[l].states[path[l]];
+            }
+
+            if ((s == 0) || (s->shift && !seg.layers[l].rest)) {
+                if (chunk.length() != 0) {
+                    chunk.makeFretDiag();
+                    FingerPosition bp = chunk.getPosition();
+                    OUTPUT(seg) << "[" << bp << "]";
+                    if (last_fp == NotDefined) {
+                        last_fp = bp;
+                        seg.first_fp = bp;
+                    }
+                    else if (last_fp != bp) {
+                        last_fp = bp;
+                        chunk.tagPositionShift();
+                        ++seg.stats.shifts;
+                    }
+                    seg.last_fp = last_fp;
+                    appendChunk(seg, chunk);
+                }
+                if (s == 0) {
+                    break;
+                }
+                chunk = Chunk();
+                chunk.setPosition(s->position);
+                chunk.setStart(cni);
+            }
+
+            if (seg.layers[l].rest) {
+                chunk.addFingering(Fingering());
+            }
+            else {
+                chunk.addFingering(s->fingering);
+            }
+        }
+
+        OUTPUT(seg) << " Done." << std::endl;
+        return true;
+    }
+
+    void Engine::offerState(SearchLayer& layer, const SearchState& x)
+    {
+        /*
+         * States that agree on position, string and finger, and on how
+         * their chunk began, are interchangeable as far as later notes are
+         * concerned, so only keep the cheapest.
+         */
+        for (std::vector<SearchState>::iterator s = layer.states.begin();
+                s != layer.states.end();
+                ++s)
+        {
+            if (((*s).position == x.position)
+                    && ((*s).fingering.strg == x.fingering.strg)
+                    && ((*s).fingering.finger == x.fingering.finger)
+                    && ((*s).fresh == x.fresh)
+                    && ((*s).jumped == x.jumped)) {
+                if (x.cost < (*s).cost) {
+                    *s = x;
+                }
+                return;
+            }
+        }
+        layer.states.push_back(x);
+    }
+
+    bool Engine::extendSearch(std::vector<SearchLayer>& layers, const Note& note)
+    {
+        /*
+         * Back-to-back glisses are only avoided where there's another way.
+         */
+        return extendSearch(layers, note, constraints_->getBTBGliss())
+            || extendSearch(layers, note, true);
+    }
+
+    bool Engine::extendSearch(std::vector<SearchLayer>& layers, const Note& note, bool btb_gliss)
+    {
+        SearchLayer layer;
+        layer.rest = note.isRest();
+
+        /*
+         * Rests before the first note leave no states, so the note after
+         * them starts afresh, as in computeGlobal().
+         */
+        const SearchLayer *prev = (layers.empty() || layers.back().states.empty()) ? 0 : &layers.back();
+
+        if (layer.rest) {
+            /*
+             * A rest leaves the hand where it was.
+             */
+            if (prev != 0) {
+                layer.states = prev->states;
+                for (unsigned int i = 0; i < layer.states.size(); ++i) {
+                    layer.states[i].back = i;
+                    layer.states[i].shift = false;
+                    layer.states[i].fresh = false;
+                    layer.states[i].jumped = false;
+                }
+            }
+            layers.push_back(layer);
+            return true;
+        }
+
+        /*
+         * A chunk of one note that was shifted into is a back-to-back
+         * gliss if it is shifted straight out of again, just as in
+         * computeChunks(); one that started afresh costs extra, as in
+         * chunkTotal().
+         */
+        int best_prev = NotDefined;
+        if (prev != 0) {
+            for (unsigned int i = 0; i < prev->states.size(); ++i) {
+                if (!btb_gliss && prev->states[i].jumped) {
+                    continue;
+                }
+                if ((best_prev == NotDefined) || (prev->states[i].cost < prev->states[best_prev].cost)) {
+                    best_prev = i;
+                }
+            }
+            if (best_prev == NotDefined) {
+                return false;
+            }
+        }
+
+        /*
+         * The restart ("=") hint means we should ignore the lead-in
+         * note - imagine that we are starting afresh.
+         */
+        bool fresh = (best_prev == NotDefined) || note.hasRestartHint();
+
+        const FretPosList& fpcandidates = instrument_->candidates(note);
+        for (FretPosList::const_iterator fp = fpcandidates.begin();
+                fp != fpcandidates.end();
+                ++fp)
+        {
+            const FingerPositionList& pcandidates = algorithm_->candidates(*fp);
+            for (FingerPositionList::const_iterator p = pcandidates.begin();
+                    p != pcandidates.end();
+                    ++p)
+            {
+                if (fresh) {
+                    Fingering cf = note.fingering();
+                    if ((best_prev != NotDefined) && note.hasGlissHint()) {
+                        cf.finger = prev->states[best_prev].fingering.finger;
+                        cf.strg = prev->states[best_prev].fingering.strg;
+                    }
+                    if ((cf.strg != NotDefined) && (cf.strg != (*fp).strg)) {
+                        continue;
+                    }
+
+                    SearchState x;
+                    x.fingering = note.fingering();
+                    x.fingering.strg = (*fp).strg;
+                    x.fingering.fret = (*fp).fret;
+                    x.position = *p;
+                    x.back = best_prev;
+                    x.shift = true;
+                    x.fresh = true;
+                    x.jumped = (best_prev != NotDefined) && (prev->states[best_prev].position != *p)
+                        && !note.hasGlissHint();
+
+                    int c = 0;
+                    if (algorithm_->startFingering(*p, 0, cf, x.fingering, c)) {
+                        x.cost = c + positionCost(note, NotDefined, *p);
+                        if (best_prev != NotDefined) {
+                            x.cost += prev->states[best_prev].cost;
+                            if (prev->states[best_prev].fresh) {
+                                x.cost += engine_single_note_penalty;
+                            }
+                        }
+                        offerState(layer, x);
+                    }
+                    continue;
+                }
+
+                for (unsigned int i = 0; i < prev->states.size(); ++i) {
+                    const SearchState& from = prev->states[i];
+
+                    Fingering cf = note.fingering();
+                    if (note.hasGlissHint()) {
+                        cf.finger = from.fingering.finger;
+                        cf.strg = from.fingering.strg;
+                    }
+                    if ((cf.strg != NotDefined) && (cf.strg != (*fp).strg)) {
+                        continue;
+                    }
+
+                    SearchState x;
+                    x.position = *p;
+                    x.back = i;
+
+                    /*
+                     * Stay in position...
+                     */
+                    if ((from.position == *p) && !note.hasBreakHint()) {
+                        x.fingering = Fingering();
+                        x.fingering.strg = (*fp).strg;
+                        x.fingering.fret = (*fp).fret;
+                        x.shift = false;
+                        x.fresh = false;
+                        x.jumped = false;
+
+                        int c = 0;
+                        if (algorithm_->nextFingering(*p, from.fingering, cf, x.fingering, c)) {
+                            x.cost = from.cost + c;
+                            offerState(layer, x);
                         }
+                    }
+
+                    /*
+                     * ...or start a new chunk.
+                     */
+                    if (!btb_gliss && from.jumped) {
+                        continue;
+                    }
+                    x.fingering = note.fingering();
+                    x.fingering.strg = (*fp).strg;
+                    x.fingering.fret = (*fp).fret;
+                    x.shift = true;
+                    x.fresh = false;
+                    x.jumped = (from.position != *p) && !note.hasGlissHint();
 
+                    int c = 0;
+                    if (algorithm_->startFingering(*p, &from.fingering, cf, x.fingering, c)) {
+                        int pdiff = absolute_diff(from.position, *p);
+                        c += positionCost(note, from.position, *p);
+                        if (pdiff > max_lh_shift) {
+                            c += (pdiff - max_lh_shift) * engine_excess_shift_penalty;
+                        }
+                        if (from.fresh) {
+                            c += engine_single_note_penalty;
+                        }
+                        x.cost = from.cost + c;
+                        offerState(layer, x);
                     }
                 }
             }
-            OUTPUT << " Done." << std::endl;
+        }
+
+        if (layer.states.empty()) {
+            return false;
+        }
+
+        layers.push_back(layer);
+        return true;
+    }
+
+    void Engine::startStream(unsigned int lookahead)
+    {
+        stream_layers_.clear();
+        stream_notes_.clear();
+        stream_anchored_ = false;
+        stream_lookahead_ = lookahead;
+        stream_fp_ = NotDefined;
+        stream_output_.clear();
+        stats_ = EngineStatistics();
+        stats_.segments = 1;
+        stats_.passes = 1;
+    }
+
+    bool Engine::pushNote(const Note& note)
+    {
+        if (note.noteNum() == NotDefined) {
+            flushStream();
+            return true;
+        }
+
+        if (!extendSearch(stream_layers_, note)) {
+            qDebug("No possible fingering for note %d!", note.noteNum());
+            return false;
+        }
+        stream_notes_.push_back(note);
+        stats_.search_states += stream_layers_.back().states.size();
+
+        while (stream_layers_.size() - (stream_anchored_ ? 1 : 0) > stream_lookahead_) {
+            finaliseStreamNote();
+        }
+        return true;
+    }
+
+    void Engine::flushStream()
+    {
+        while (stream_layers_.size() > (stream_anchored_ ? 1U : 0U)) {
+            finaliseStreamNote();
+        }
+    }
 
-        } while ((hint_type_ != ANNO_NONE) && (pass_num < max_pass));
-        
+    bool Engine::takeNote(Note& n)
+    {
+        if (stream_output_.empty()) {
+            return false;
+        }
+        n = stream_output_.front();
+        stream_output_.pop_front();
         return true;
     }
 
+    void Engine::finaliseStreamNote()
+    {
+        unsigned int u = stream_anchored_ ? 1 : 0;
+        Q_ASSERT(u < stream_layers_.size());
+
+        Note n(stream_notes_[u].noteNum());
+        n.setDuration(stream_notes_[u].duration());
+
+        if (stream_layers_[u].states.empty()) {
+            /*
+             * Rests before the first note - nothing to decide.
+             */
+            Q_ASSERT(stream_layers_[u].rest);
+            stream_output_.push_back(n);
+            stream_layers_.erase(stream_layers_.begin() + u);
+            stream_notes_.erase(stream_notes_.begin() + u);
+            return;
+        }
+
+        /*
+         * Trace the cheapest path so far back to this note.
+         */
+        const std::vector<SearchState>& last_states = stream_layers_.back().states;
+        int k = 0;
+        for (unsigned int i = 1; i < last_states.size(); ++i) {
+            if (last_states[i].cost < last_states[k].cost) {
+                k = i;
+            }
+        }
+        for (unsigned int l = stream_layers_.size() - 1; l > u; --l) {
+            k = stream_layers_[l].states[k].back;
+        }
+        SearchState chosen = stream_layers_[u].states[k];
+
+        if (!stream_layers_[u].rest) {
+            n.setFingering(chosen.fingering);
+            if (chosen.shift && (stream_fp_ != NotDefined) && (stream_fp_ != chosen.position)) {
+                n.addAnnotation(ANNO_SHIFT);
+                ++stats_.shifts;
+            }
+            stream_fp_ = chosen.position;
+        }
+        /* Relative to the last anchor, so this is what the note added */
+        stats_.cost += chosen.cost;
+        stream_output_.push_back(n);
+
+        /*
+         * This note becomes the anchor: forget its other states, and
+         * everything that was descended from them. Costs are kept relative
+         * to the anchor so that they don't grow without limit.
+         */
+        stream_layers_.erase(stream_layers_.begin(), stream_layers_.begin() + u);
+        stream_notes_.erase(stream_notes_.begin(), stream_notes_.begin() + u);
+        stream_anchored_ = true;
+
+        std::vector<int> remap(stream_layers_[0].states.size(), NotDefined);
+        remap[k] = 0;
+        stream_layers_[0].states.assign(1, chosen);
+        stream_layers_[0].states[0].back = NotDefined;
+        stream_layers_[0].states[0].cost = 0;
+
+        for (unsigned int l = 1; l < stream_layers_.size(); ++l) {
+            std::vector<SearchState>& states = stream_layers_[l].states;
+            std::vector<int> next_remap(states.size(), NotDefined);
+            unsigned int kept = 0;
+            for (unsigned int i = 0; i < states.size(); ++i) {
+                if ((states[i].back == NotDefined) || (remap[states[i].back] == NotDefined)) {
+                    continue;
+                }
+                next_remap[i] = kept;
+                states[kept] = states[i];
+                states[kept].back = remap[states[i].back];
+                states[kept].cost -= chosen.cost;
+                ++kept;
+            }
+            states.resize(kept);
+            remap.swap(next_remap);
+        }
+    }
+
+    void Engine::appendChunk(Segment& seg, const Chunk& chunk)
+    {
+        if (!chunk.fretDiagram().empty()) {
+            seg.diagrams[seg.output.size()] = chunk.fretDiagram();
+        }
+        chunk.appendTo(seg.output);
+    }
+
+    int Engine::positionCost(const Note& note, FingerPosition last_fp, FingerPosition new_fp)
+    {
+        int c = 0;
+
+        if (last_fp != NotDefined) {
+            if (note.hasAnnotation(HINT_SHIFT_UP)) {
+                c += hintUpCost(last_fp, new_fp);
+            }
+            else if (note.hasAnnotation(HINT_SHIFT_DOWN)) {
+                c += hintDownCost(last_fp, new_fp);
+            }
+            else {
+                /*
+                 * Add a penalty for large position skips.
+                 * In other words, if two starting positions yield similar
+                 * results, then the one that involves the smaller movement
+                 * from the last position is better.
+                 */
+                c += absolute_diff(new_fp, last_fp);
+            }
+        }
+        else {
+            if (note.hasAnnotation(HINT_SHIFT_UP)) {
+                c += hintUpCost(new_fp);
+            }
+            else if (note.hasAnnotation(HINT_SHIFT_DOWN)) {
+                c += hintDownCost(new_fp);
+            }
+            else {
+                /*
+                 * Prefer a lower position, but don't be silly about it.
+                 */
+                if (new_fp > 7) {
+                    c += (new_fp - 7);
+                }
+                if (new_fp < 5) {
+                    c += (5 - new_fp);
+                }
+            }
+        }
+
+        return c;
+    }
+
     int Engine::hintUpCost(FingerPosition last_fp, FingerPosition new_fp)
     {
         int c = 0;
@@ -614,7 +1841,7 @@ namespace Holdsworth {
 
     void Engine::dumpLilyPond(QTextStream &os, bool use_flats, bool show_annotations)
     {
-        dbgLilypondDumpNoteList(nlist_, os, true, use_flats, show_annotations);
+        dbgLilypondDumpNoteList(nlist_, os, true, use_flats, show_annotations, &diagrams_);
     }
 
     void Engine::dumpLilyPondTab(QTextStream &os)
@@ -29,9 +29,73 @@
 #include <holdsworth/instrumentdefn.h>
 #include <holdsworth/constraints.h>
 #include <holdsworth/algorithm.h>
+#include <vector>
+#include <deque>
+#include <map>
+
+class QThreadPool;
+class QAtomicInt;
 
 namespace Holdsworth {
 
+struct ScorePart;
+class ResultCache;
+
+/*!
+ * \brief Counters describing the work done by the most recent Engine::compute().
+ *
+ * The counters are cheap to keep, so they are always kept.
+ */
+struct EngineStatistics {
+    EngineStatistics()
+        : chunk_cache_hits(0)
+        , chunk_cache_misses(0)
+        , chunk_candidates(0)
+        , chunks_pruned(0)
+        , chunks_generated(0)
+        , hints_inserted(0)
+        , hints_purged(0)
+        , search_states(0)
+        , result_cache_hits(0)
+        , segments(0)
+        , passes(0)
+        , cost(0)
+        , shifts(0)
+        {}
+
+    /*! \brief Add in the counters for another part of the input.
+     */
+    EngineStatistics& operator+=(const EngineStatistics& x)
+    {
+        chunk_cache_hits += x.chunk_cache_hits;
+        chunk_cache_misses += x.chunk_cache_misses;
+        chunk_candidates += x.chunk_candidates;
+        chunks_pruned += x.chunks_pruned;
+        chunks_generated += x.chunks_generated;
+        hints_inserted += x.hints_inserted;
+        hints_purged += x.hints_purged;
+        search_states += x.search_states;
+        result_cache_hits += x.result_cache_hits;
+        passes += x.passes;
+        cost += x.cost;
+        shifts += x.shifts;
+        return *this;
+    }
+
+    unsigned int chunk_cache_hits;     /*!< Chunks re-used from an earlier pass */
+    unsigned int chunk_cache_misses;   /*!< Chunks that had to be scored */
+    unsigned int chunk_candidates;     /*!< Starting fingerings considered for chunks */
+    unsigned int chunks_pruned;        /*!< Chunks abandoned part way through scoring */
+    unsigned int chunks_generated;     /*!< Calls to Algorithm::generateChunk() */
+    unsigned int hints_inserted;       /*!< Auto-hints added to the input */
+    unsigned int hints_purged;         /*!< Auto-hints removed again by later passes */
+    unsigned int search_states;        /*!< States kept by a global search */
+    unsigned int result_cache_hits;    /*!< compute()s answered by the ResultCache, with no other work */
+    unsigned int segments;             /*!< Parts fingered independently */
+    unsigned int passes;               /*!< Passes made, over all the segments */
+    int cost;                          /*!< Total cost of the chosen chunks */
+    unsigned int shifts;               /*!< Position shifts in the output */
+};
 
 /*!
  *  \brief Fingering generation engine. Main access point for the consumer of the library.
@@ -55,8 +119,23 @@ namespace Holdsworth {
 class Engine
 {
 public:
+    /*! \brief How the engine searches for a fingering.
+     */
+    enum SearchMode {
+        /*! Chunk-by-chunk "maximal munch" search, with auto-hint passes to
+         * smooth out excessive position shifts. */
+        ChunkSearch,
+        /*! Single pass dynamic programme over every (position, string, finger)
+         * state of every note. Finds the cheapest path through the whole
+         * note list, so no auto-hint passes are needed. Chunk search's
+         * rules are costed the same way: back-to-back glisses are avoided
+         * unless the Constraints allow them, and a one-note chunk that
+         * starts afresh pays the same penalty. */
+        GlobalSearch
+    };
+
     Engine();
-    virtual ~Engine() {/*empty*/}
+    virtual ~Engine();
 
     /*! \brief Compute an optimal fingering for a set of note data.
      *
@@ -69,6 +148,15 @@ public:
      */
     bool compute(const NoteList& source_note_list_, int max_pass);
 
+    /*! \brief Compute a fingering for each part of a score.
+     *
+     * Each part is fingered on its own, with the same settings as compute(),
+     * and up to setThreads() of them at once. Every part's notes must end
+     * with a NotDefined sentinel. The results are left in the parts, and
+     * statistics() covers them all; output() is left empty.
+     */
+    bool computeScore(std::vector<ScorePart>& score, int max_pass);
+
     /*! \brief Accessor function for output data.
      *
      * This only returns anything meaningful after a successful call to compute(). The
@@ -77,16 +165,86 @@ public:
      */
     const NoteList& output() const {return nlist_;}
 
+    /*! \brief Fret diagrams for the start of each chunk in output().
+     */
+    const FretDiagramMap& diagrams() const {return diagrams_;}
+
+    /*! \brief Accessor function for statistics about the last call to compute(),
+     * or about the stream so far.
+     */
+    const EngineStatistics& statistics() const {return stats_;}
+
     void setInstrument(InstrumentDefn *);   /*!< Settor function for associated InstrumentDefn */
     void setConstraints(Constraints *);	    /*!< Settor function for associated Constraints */
     void setAlgorithm(Algorithm *);    	    /*!< Settor function for associated Algorithm */
 
-    /* \brief Change the maximum allowed LH Shift.
+    /*! \brief Change the maximum allowed LH Shift.
      *
      * The default is dflt_engine_max_lh_shift.
      */
     void setMaxLHShift(int x) {max_lh_shift = x;}
 
+    /*! \brief Select the search method used by compute().
+     *
+     * The default is ChunkSearch.
+     */
+    void setSearchMode(SearchMode x) {search_mode_ = x;}
+
+    /*! \brief Set the number of threads used to generate candidate chunks.
+     *
+     * The default is 1, i.e. everything happens in the calling thread.
+     * The result does not depend on the number of threads.
+     */
+    void setThreads(int x) {threads_ = (x < 1) ? 1 : x;}
+
+    /*! \brief Allow compute() to split the input at restart hints.
+     *
+     * The fingering before a restart hint has no influence on the one after
+     * it, so the parts can be fingered independently, and in parallel.
+     * Auto-hints are then confined to the part that needs them. The default
+     * is false.
+     */
+    void setSplitAtRestarts(bool x) {split_segments_ = x;}
+
+    /*! \brief Look up the result of compute() in the given cache before
+     * fingering anything, and keep it there afterwards.
+     *
+     * The key covers the notes, the instrument, algorithm, cost weights,
+     * constraints and every setting above except the number of threads.
+     * computeScore() uses the cache for each part. The default is no
+     * cache.
+     */
+    void setResultCache(ResultCache *x) {result_cache_ = x;}
+
+    /*! \brief Start fingering a stream of notes, e.g. live MIDI input.
+     *
+     * \param lookahead Number of later notes that must have been pushed
+     * before a note's fingering is final.
+     *
+     * The stream is fingered with the same search as GlobalSearch, but only
+     * the notes that are not yet final are kept, so the work per note does
+     * not grow with the length of the stream. No NotDefined sentinel is
+     * needed. Fret diagrams are not generated.
+     */
+    void startStream(unsigned int lookahead);
+
+    /*! \brief Add the next note of the stream.
+     *
+     * Returns false (and ignores the note) if it cannot be fingered.
+     * Passing a NotDefined note is the same as calling flushStream().
+     */
+    bool pushNote(const Note&);
+
+    /*! \brief Finalise every note pushed so far, e.g. at the end of a phrase.
+     */
+    void flushStream();
+
+    /*! \brief Collect the next finalised note of the stream, in order.
+     *
+     * Returns false if there are none waiting.
+     */
+    bool takeNote(Note&);
+
 #ifndef PURE_STL_INTERFACE
     /*! \brief Dump a Lilypond format stream of the rendered notes.
      *
@@ -131,21 +289,156 @@ protected:
      * Override this function to change the auto-hint behaviour.
      */ 
     virtual int hintDownCost(FingerPosition new_fp);
+
+    /*! \brief Cost of starting a chunk in a given position.
+     *
+     * \param last_fp   Position of the previous chunk, or NotDefined if
+     * there is no previous chunk (or it is to be ignored.)
+     */
+    int positionCost(const Note&, FingerPosition last_fp, FingerPosition new_fp);
     
 private:
+    /*! \brief One candidate fingering of a note in the global search.
+     */
+    struct SearchState {
+        Fingering       fingering;
+        FingerPosition  position;
+        int             cost;   /*!< Cost of the cheapest path to this state */
+        int             back;   /*!< Predecessor in previous layer (NotDefined if none) */
+        bool            shift;  /*!< Arrived at by starting a new chunk */
+        bool            fresh;  /*!< That chunk starts afresh at this note */
+        bool            jumped; /*!< That chunk moved to a new position at this note */
+    };
+
+    /*! \brief All candidate fingerings of a note in the global search.
+     */
+    struct SearchLayer {
+        std::vector<SearchState> states;
+        bool rest;
+    };
+
+    /*! \brief State of a compute() pass at a chunk boundary.
+     */
+    struct Checkpoint {
+        ConstNoteIterator   note;               /*!< First note of the next chunk */
+        unsigned int        note_index;
+        ConstNoteIterator   start_of_last_chunk;
+        FingerPosition      last_fp;
+        unsigned int        output_length;      /*!< Size of Segment::output */
+        int                 cost;               /*!< Segment::stats.cost */
+        unsigned int        shifts;             /*!< Segment::stats.shifts */
+        /*! One past the last note examined by any chunk before this point */
+        unsigned int        reach;
+    };
+
+    /*! \brief Key for the chunk cache.
+     */
+    struct ChunkKey {
+        unsigned int    note;           /*!< Index of the first note in Segment::source */
+        FingerPosition  position;
+        FretPos         start;
+        FingerNum       force_finger;
+        Fingering       lead_in;        /*!< Undefined if there is no lead-in note */
+
+        bool operator<(const ChunkKey&) const;
+    };
+
+    /*! \brief Chunks scored in earlier passes of compute(). Only the
+     * notes after an auto-hint change between passes, so most of these
+     * can be re-used.
+     */
+    typedef std::map<ChunkKey, ChunkScore> ChunkCache;
+
+    /*! \brief The entries of a ChunkCache by the index of the note that
+     * stopped each chunk, so those that a hint change spoils are found
+     * without looking at the rest.
+     */
+    typedef std::multimap<unsigned int, ChunkCache::iterator> ChunkCacheEnds;
+
+    /*! \brief A possible start for the next chunk.
+     */
+    struct ChunkCandidate {
+        FretPos         start;
+        FingerPosition  position;
+        int             position_cost;  /*!< Cost of moving to position */
+        bool            fresh;          /*!< No previous chunk to move from */
+        ChunkKey        key;
+        ChunkScore      score;
+    };
+
+    /*! \brief Working state for fingering one part of the input.
+     */
+    struct Segment {
+        Segment();
+
+        NoteList            source;         /*!< Input notes, with autohints */
+        NoteList            output;
+        FretDiagramMap      diagrams;       /*!< Keyed by index into output */
+        std::vector<ConstNoteIterator> hint_locations;  /*!< In order */
+        Annotation          hint_type;
+        ChunkCache          chunk_cache;
+        ChunkCacheEnds      chunk_cache_ends;
+        std::vector<SearchLayer> layers;
+        FingerPosition      first_fp;       /*!< Position of the first chunk */
+        FingerPosition      last_fp;        /*!< Position of the last chunk */
+        EngineStatistics    stats;
+        bool                threaded;       /*!< May use the chunk thread pool */
+        bool                progress;       /*!< Show progress output */
+        bool                ok;
+    };
+
+    class ChunkWorker;
+    class SegmentWorker;
+    class PartWorker;
+
+    void generateChunks(Segment&, std::vector<ChunkCandidate>&, ConstNoteIterator, unsigned int, const Fingering& force_first, const Note *lead_in, const unsigned int *notes_left);
+    static int chunkTotal(const ChunkCandidate&);
+    static void offerBest(QAtomicInt&, int total);
+    void invalidateChunkCache(Segment&, unsigned int first_changed);
+    static void countNotesLeft(const NoteList&, std::vector<unsigned int>& notes_left, unsigned int first_changed, unsigned int last_changed);
+
+    void appendChunk(Segment&, const Chunk&);
+    std::string resultKey(const NoteList&, int max_pass) const;
+    bool computeSegment(Segment&, int max_pass);
+    bool computeChunks(Segment&, int max_pass);
+    void placeHints(Segment&, ConstNoteIterator first, ConstNoteIterator end, const std::vector<ConstNoteIterator>& crossing_points, unsigned int hints);
+    bool computeGlobal(Segment&);
+    bool extendSearch(std::vector<SearchLayer>&, const Note&);
+    bool extendSearch(std::vector<SearchLayer>&, const Note&, bool btb_gliss);
+    static void offerState(SearchLayer&, const SearchState&);
+    void finaliseStreamNote();
+
     InstrumentDefn      *instrument_;
     Constraints	        *constraints_;
     Algorithm	        *algorithm_;
 
     NoteList            nlist_;
-    NoteList            source_note_list_;
-    ConstNoteIterator   hint_location_;
-    Annotation		hint_type_;
+    FretDiagramMap      diagrams_;
 
     /*! \brief Maximum size of a position shift (in frets) that we will accept
      * before invoking the auto-hinter. see dflt_engine_max_lh_shift.
      */
     int                 max_lh_shift;
+
+    SearchMode                  search_mode_;
+    EngineStatistics            stats_;
+
+    int                         threads_;
+    QThreadPool                 *pool_;
+    bool                        split_segments_;
+    bool                        progress_;      /*!< Show progress output */
+    ResultCache                 *result_cache_;
+
+    /*! \brief Search layers for the notes of the stream that are not yet
+     * final. If stream_anchored_, the first one is the last final note,
+     * reduced to the state that was chosen.
+     */
+    std::vector<SearchLayer>    stream_layers_;
+    std::vector<Note>           stream_notes_;  /*!< Notes of stream_layers_ */
+    bool                        stream_anchored_;
+    unsigned int                stream_lookahead_;
+    FingerPosition              stream_fp_;     /*!< Position of the last final note */
+    std::deque<Note>            stream_output_;
 };
 
 }
@@ -24,104 +24,75 @@
 
 
 namespace {
-    /*! \brief The penalty assigned to taking a note on the little finger.
-     *
-     * Other things being equal, it is nice to avoid notes on the little finger
-     * as some people find it awkward. So we assign a small penalty to pinky
-     * notes. It is only small though, to act as a tiebreaker.  Taking a note
-     * on the pinky is always better than some other nasty position shift.
+    /*! \brief Highest fret for which candidate positions are tabulated.
      */
-    const int vn_pinky_penalty = 1;
-
-    /*! \brief The penalty assigned to using a first finger extension.
-     */
-    const int vn_index_stretch_penalty = 1;
-    
-    /*! \brief The penalty assigned to using a little finger extension. This is in
-     * addition to the usual penalty.
-     */
-    const int vn_pinky_stretch_penalty = 1;
+    const Holdsworth::FretNum handmodel_max_fret = 48;
 }
 
 namespace Holdsworth {
 
     HandModel::HandModel()
-    {
-	/* Nothing */
-    }
-    
-    FingerPositionList HandModel::candidates(const FretPos& x)
+        : min_offset_(0)
+        , max_offset_(-1)
+        , candidate_table_()
+        , no_candidates_()
+        , finger_table_()
+        , stretch_table_()
+        , cost_table_()
     {
 	/*
 	 * For now, let's hard code a simple one-per-fret setup.
 	 */
-	FingerPositionList fpl;
-
-	int fret = x.fret;
-
-	while ((fret > 0) && (fpl.size() < 4)) {
-	    fpl.push_back(fret);
-	    --fret;
-	}
-	return fpl;
+        setReach(0, FirstFinger, false);
+        setReach(1, MiddleFinger, false);
+        setReach(2, RingFinger, false);
+        setReach(3, LittleFinger, false);
+        buildTables();
     }
-    
-    FingerNum HandModel::getFinger(FretNum f, FingerPosition start_p)
-    {
-	FingerNum finger = NoFingerDefined;
-	switch (f - start_p) {
-	    case 0:
-		finger = FirstFinger;
-		break;
-
-	    case 1:
-		finger = MiddleFinger;
-		break;
-
-	    case 2:
-		finger = RingFinger;
-		break;
-
-	    case 3:
-		finger = LittleFinger;
-		break;
-
-	    default:
-		qDebug("POSITION breakdown: diff = %d", f - start_p);
-	}
 
-	return finger;
-    }
-
-    bool HandModel::isStretch(FretNum f, FingerPosition start_p)
+    void HandModel::setReach(int offset, FingerNum finger, bool stretch)
     {
-	switch (f - start_p) {
-	    case 0:
-	    case 1:
-	    case 2:
-	    case 3:
-		return false;
-		break;
-
-	    default:
-		return true;
-	}
+        if (max_offset_ < min_offset_) {
+            min_offset_ = max_offset_ = offset;
+            finger_table_.assign(2, NoFingerDefined);
+            stretch_table_.assign(2, true);
+        }
+        while (offset < min_offset_) {
+            --min_offset_;
+            finger_table_.insert(finger_table_.begin() + 1, NoFingerDefined);
+            stretch_table_.insert(stretch_table_.begin() + 1, true);
+        }
+        while (offset > max_offset_) {
+            ++max_offset_;
+            finger_table_.push_back(NoFingerDefined);
+            stretch_table_.push_back(true);
+        }
+        finger_table_[row(offset)] = finger;
+        stretch_table_[row(offset)] = stretch;
     }
-    
-    int HandModel::cost(const Fingering& f, FingerPosition p)
-    {
-        int c = 0;
 
-        if (f.finger == LittleFinger) {
-            c += vn_pinky_penalty;
-            if (isStretch(f.fret, p)) {
-                c += vn_pinky_stretch_penalty;
+    void HandModel::buildTables()
+    {
+        /*
+         * Positions are numbered from 1, so a fret can only be reached
+         * from the positions above zero.
+         */
+        candidate_table_.clear();
+        candidate_table_.resize(handmodel_max_fret + 1);
+        for (FretNum fret = 0; fret <= handmodel_max_fret; ++fret) {
+            for (int offset = min_offset_; offset <= max_offset_; ++offset) {
+                if (fret - offset > 0) {
+                    candidate_table_[fret].push_back(fret - offset);
+                }
             }
         }
-        else if (isStretch(f.fret, p)) {
-            c += vn_index_stretch_penalty;
-        }
 
-        return c;
+        const CostWeights weights;
+        cost_table_.assign(finger_table_.size() * finger_slots, 0);
+        for (unsigned int r = 0; r < finger_table_.size(); ++r) {
+            for (int finger = NoFingerDefined; finger <= LittleFinger; ++finger) {
+                cost_table_[r * finger_slots + finger + 1] = handCost((FingerNum) finger, stretch_table_[r] != 0, weights);
+            }
+        }
     }
 };
@@ -24,12 +24,29 @@
 
 #include <holdsworth/types.h>
 #include <holdsworth/note.h>
+#include <holdsworth/costweights.h>
+#include <vector>
 
 namespace Holdsworth {
 
+/*! \brief Inherent cost of taking a note on the given finger, with or
+ * without a stretch.
+ */
+inline int handCost(FingerNum finger, bool stretch, const CostWeights& w)
+{
+    if (finger == LittleFinger) {
+        return w.pinky_penalty + (stretch ? w.pinky_stretch_penalty : 0);
+    }
+    return stretch ? w.index_stretch_penalty : 0;
+}
+
 /*!
  * \brief Base class for a model of the capabilities of the left hand (note span etc.)
  *
+ * The model is described by the finger that covers each fret relative to the
+ * position (the "offset"), and whether reaching it is a stretch. Subclasses
+ * describe any extra reach in their constructor with setReach(), and then
+ * call buildTables(). All the lookups are then simple table reads.
  */
 class HandModel
 {
@@ -43,15 +60,32 @@ public:
      *
      * A candidate position is one in which the given fret/string falls under the reach of the LH.
      */
-    virtual FingerPositionList candidates(const FretPos&);
+    const FingerPositionList& candidates(const FretPos& x) const
+    {
+        if ((x.fret < 0) || (x.fret >= (FretNum) candidate_table_.size())) {
+            return no_candidates_;
+        }
+        return candidate_table_[x.fret];
+    }
+
+    /*! \brief Indicate if the given fret can be reached from the given
+     * position, i.e. if the position is one of candidates().
+     */
+    bool inReach(FretNum f, FingerPosition start_p) const
+    {
+        return (start_p > 0) && (f - start_p >= min_offset_) && (f - start_p <= max_offset_);
+    }
 
     /*! \brief Return the finger that is used for a given fret in a given
-     * position.
+     * position, or NoFingerDefined if it is out of reach.
      *
      * \todo Strictly, this should return a candidate list. At the moment
      * we are assuming a strict "each fret is only covered by one finger" model.
      */
-    virtual FingerNum getFinger(FretNum, FingerPosition);
+    FingerNum getFinger(FretNum f, FingerPosition start_p) const
+    {
+        return (FingerNum) finger_table_[row(f - start_p)];
+    }
 
     /*! \brief Indicate if reaching the given fret from the given position
      * involves a stretch.
@@ -59,10 +93,98 @@ public:
      * \todo There should be a variant of this which passes in the finger. At the moment
      * we are assuming a strict "each fret is only covered by one finger" model.
      */
-    virtual bool isStretch(FretNum, FingerPosition);
+    bool isStretch(FretNum f, FingerPosition start_p) const
+    {
+        return stretch_table_[row(f - start_p)] != 0;
+    }
+
+    /*! \brief Cost of playing the given fingering from the given position,
+     * with the default CostWeights.
+     */
+    int cost(const Fingering& f, FingerPosition p) const
+    {
+        return cost_table_[row(f.fret - p) * finger_slots + f.finger + 1];
+    }
+
+protected:
+    /*! \brief Say which finger covers the fret at the given offset from
+     * the position, extending the reach of the hand if necessary.
+     */
+    void setReach(int offset, FingerNum, bool stretch);
+
+    /*! \brief Rebuild the lookup tables after a change to the reach.
+     */
+    void buildTables();
+
+private:
+    /*! \brief Table row for an offset. Row 0 is for anything out of reach.
+     */
+    unsigned int row(int offset) const
+    {
+        return ((offset < min_offset_) || (offset > max_offset_)) ? 0 : (offset - min_offset_ + 1);
+    }
 
-    virtual int cost(const Fingering&, FingerPosition);
+    /*! NoFingerDefined, OpenString and the four fingers */
+    static const int finger_slots = 6;
+
+    int min_offset_;
+    int max_offset_;
+
+    std::vector<FingerPositionList> candidate_table_;  /*!< Indexed by fret */
+    FingerPositionList              no_candidates_;
+    std::vector<signed char>        finger_table_;     /*!< Indexed by row() */
+    std::vector<char>               stretch_table_;    /*!< Indexed by row() */
+    std::vector<int>                cost_table_;       /*!< Indexed by row() and finger */
 };
 
+/*!
+ * \brief Compile-time description of a hand, for algorithms that are
+ * specialised on the hand model (see VNAlgorithmT).
+ *
+ * The fingers cover the offsets 0 to 3 from the position one-per-fret.
+ * Extending the reach to MinOffset (below 0) is a first finger stretch,
+ * and to MaxOffset (above 3) is a little finger stretch. The answers are
+ * the same as those of the matching Model, but can be inlined.
+ */
+template <int MinOffset, int MaxOffset, class Model>
+struct HandPolicy
+{
+    typedef Model ModelType;   /*!< \brief Run-time equivalent of this hand */
+
+    static bool inReach(FretNum f, FingerPosition start_p)
+    {
+        return (start_p > 0) && (f - start_p >= MinOffset) && (f - start_p <= MaxOffset);
+    }
+
+    static FingerNum getFinger(FretNum f, FingerPosition start_p)
+    {
+        const int offset = f - start_p;
+        if ((offset < MinOffset) || (offset > MaxOffset)) {
+            return NoFingerDefined;
+        }
+        if (offset <= 0) {
+            return FirstFinger;
+        }
+        if (offset >= 3) {
+            return LittleFinger;
+        }
+        return (FingerNum) (FirstFinger + offset);
+    }
+
+    static bool isStretch(FretNum f, FingerPosition start_p)
+    {
+        const int offset = f - start_p;
+        return (offset < 0) || (offset > 3);
+    }
+
+    static int cost(const Fingering& f, FingerPosition p, const CostWeights& w)
+    {
+        return handCost(f.finger, isStretch(f.fret, p), w);
+    }
+};
+
+/*! \brief Compile-time equivalent of HandModel */
+typedef HandPolicy<0, 3, HandModel> StandardHand;
+
 }
 #endif /* HOLDSWORTH_HANDMODEL_H */
@@ -27,72 +27,10 @@ namespace Holdsworth {
     HandModelX::HandModelX()
         : HandModel()
     {
-        /* Nothing */
-    }
-    
-    FingerPositionList HandModelX::candidates(const FretPos& x)
-    {
-#ifdef EXTRA_DEBUG
-        qDebug("FingerPositionList HandModelX::candidates for fretpos= s: %d f: %d", x.strg, x.fret);
-#endif
-        FingerPositionList fpl;
-
-        int fret = x.fret + 1;
-
-        while ((fret > 0) && (fpl.size() < 5)) {
-#ifdef EXTRA_DEBUG
-            qDebug("Adding %d as a possible position", fret);
-#endif
-            fpl.push_back(fret);
-            --fret;
-        }
-        return fpl;
-    }
-    
-    FingerNum HandModelX::getFinger(FretNum f, FingerPosition start_p)
-    {
-        FingerNum finger = NoFingerDefined;
-        switch (f - start_p) {
-            case -1:
-            case 0:
-                finger = FirstFinger;
-                break;
-
-            case 1:
-                finger = MiddleFinger;
-                break;
-
-            case 2:
-                finger = RingFinger;
-                break;
-
-            case 3:
-                finger = LittleFinger;
-                break;
-
-            default:
-                qDebug("POSITION breakdown: diff = %d", f - start_p);
-        }
-
-        return finger;
-    }
-
-    bool HandModelX::isStretch(FretNum f, FingerPosition start_p)
-    {
-        switch (f - start_p) {
-            case -1:
-                return true;
-                break;
-
-            case 0:
-            case 1:
-            case 2:
-            case 3:
-                return false;
-                break;
-
-            default:
-                return true;
-        }
+        /*
+         * First finger extension
+         */
+        setReach(-1, FirstFinger, true);
+        buildTables();
     }
 };
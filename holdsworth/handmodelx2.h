@@ -39,33 +39,10 @@ class HandModelX2 : public HandModel
 public:
     HandModelX2();
     virtual ~HandModelX2() {/*empty*/}
-
-
-    /*! \brief Return candidate LH positions for a given position on the
-     * fingerboard.
-     *
-     * A candidate position is one in which the given fret/string falls under the reach of the LH.
-     */
-    virtual FingerPositionList candidates(const FretPos&);
-
-    /*! \brief Return the finger that is used for a given fret in a given
-     * position.
-     *
-     * \todo Strictly, this should return a candidate list. At the moment
-     * we are assuming a strict "each fret is only covered by one finger" model.
-     */
-    virtual FingerNum getFinger(FretNum, FingerPosition);
-
-    /*! \brief Indicate if reaching the given fret from the given position
-     * involves a stretch.
-     *
-     * \todo There should be a variant of this which passes in the finger. At the moment
-     * we are assuming a strict "each fret is only covered by one finger" model.
-     */
-    virtual bool isStretch(FretNum, FingerPosition);
-
-    virtual int cost(const Fingering&, FingerPosition);
 };
 
+/*! \brief Compile-time equivalent of HandModelX2 */
+typedef HandPolicy<-1, 4, HandModelX2> DoubleExtendedHand;
+
 }
 #endif /* HOLDSWORTH_HANDMODELX2_H */
@@ -0,0 +1,50 @@
+# The Holdsworth library, for inclusion in the programs that use it.
+
+INCLUDEPATH += $$PWD/..
+
+HEADERS += $$PWD/algorithm.h
+HEADERS += $$PWD/vn_algorithm.h
+HEADERS += $$PWD/chunk.h
+HEADERS += $$PWD/constraints.h
+HEADERS += $$PWD/costweights.h
+HEADERS += $$PWD/engine.h
+HEADERS += $$PWD/instrumentdefn.h
+HEADERS += $$PWD/note.h
+HEADERS += $$PWD/score.h
+HEADERS += $$PWD/types.h
+HEADERS += $$PWD/debugging.h
+HEADERS += $$PWD/handmodel.h
+HEADERS += $$PWD/handmodelx.h
+HEADERS += $$PWD/handmodelx2.h
+HEADERS += $$PWD/musicxmlloader.h
+HEADERS += $$PWD/musicxmlparser.h
+HEADERS += $$PWD/musicxmlreader.h
+HEADERS += $$PWD/mxlarchive.h
+HEADERS += $$PWD/notecache.h
+HEADERS += $$PWD/resultcache.h
+HEADERS += $$PWD/textloader.h
+HEADERS += $$PWD/trace.h
+
+SOURCES += $$PWD/algorithm.cpp
+SOURCES += $$PWD/vn_algorithm.cpp
+SOURCES += $$PWD/chunk.cpp
+SOURCES += $$PWD/costweights.cpp
+SOURCES += $$PWD/engine.cpp
+SOURCES += $$PWD/instrumentdefn.cpp
+SOURCES += $$PWD/note.cpp
+SOURCES += $$PWD/score.cpp
+SOURCES += $$PWD/debugging.cpp
+SOURCES += $$PWD/handmodel.cpp
+SOURCES += $$PWD/handmodelx.cpp
+SOURCES += $$PWD/handmodelx2.cpp
+SOURCES += $$PWD/musicxmlloader.cpp
+SOURCES += $$PWD/musicxmlparser.cpp
+SOURCES += $$PWD/musicxmlreader.cpp
+SOURCES += $$PWD/mxlarchive.cpp
+SOURCES += $$PWD/notecache.cpp
+SOURCES += $$PWD/resultcache.cpp
+SOURCES += $$PWD/textloader.cpp
+SOURCES += $$PWD/trace.cpp
+
+# For inflating compressed (.mxl) MusicXML
+LIBS += -lz
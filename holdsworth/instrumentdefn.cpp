@@ -27,6 +27,8 @@ namespace Holdsworth {
 
     InstrumentDefn::InstrumentDefn()
         : strings_()
+        , candidate_table_()
+        , no_candidates_()
     {
         /*
          * For initial testing, make this base instrument a guitar in
@@ -38,37 +40,49 @@ namespace Holdsworth {
         strings_.push_back(InstrumentString(55, 18)); /* G */
         strings_.push_back(InstrumentString(59, 20)); /* B */
         strings_.push_back(InstrumentString(64, 22)); /* E */
+
+        buildCandidateTable();
     }
     
-    FretPosList InstrumentDefn::candidates(const Note& the_note)
+    void InstrumentDefn::buildCandidateTable()
     {
         Q_ASSERT(!strings_.empty());
-        const NoteNum nn = the_note.noteNum();
-        
-        FretPosList fpl;
-        
-        StringNum sn = 1;
+
+        NoteNum highest = 0;
         for (InstrumentStringList::const_iterator s = strings_.begin();
                 s != strings_.end();
-                ++s, ++sn)
+                ++s)
         {
-            if (((*s).basenote <= nn) && ((*s).basenote + (*s).num_frets >= nn)) {
-                FretPos fp;
-                fp.strg = sn;
-                fp.fret = nn - (*s).basenote;
-		
-		if (fp.fret == 0) {
-		    /*
-		     * Open string.
-		     */
-		}
-		else {
-		    fpl.push_back(fp);
-		}
-            }
+            highest = qMax(highest, (NoteNum) ((*s).basenote + (*s).num_frets));
         }
 
-        return fpl;
+        candidate_table_.clear();
+        candidate_table_.resize(highest + 1);
+
+        for (NoteNum nn = 0; nn <= highest; ++nn) {
+            FretPosList& fpl = candidate_table_[nn];
+
+            StringNum sn = 1;
+            for (InstrumentStringList::const_iterator s = strings_.begin();
+                    s != strings_.end();
+                    ++s, ++sn)
+            {
+                if (((*s).basenote <= nn) && ((*s).basenote + (*s).num_frets >= nn)) {
+                    FretPos fp;
+                    fp.strg = sn;
+                    fp.fret = nn - (*s).basenote;
+
+                    if (fp.fret == 0) {
+                        /*
+                         * Open string.
+                         */
+                    }
+                    else {
+                        fpl.push_back(fp);
+                    }
+                }
+            }
+        }
     }
 
     Note InstrumentDefn::noteAt(const FretPos& fp)
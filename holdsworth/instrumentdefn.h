@@ -61,16 +61,38 @@ public:
     virtual ~InstrumentDefn() {/*empty*/}
 
     /*! \brief Return candidate fret positions for a given note.
+     *
+     * The list is looked up in a table built by buildCandidateTable(), so
+     * nothing is allocated. It is empty for rests and unplayable notes.
      */
-    FretPosList candidates(const Note&);
+    const FretPosList& candidates(const Note& n) const
+    {
+        const NoteNum nn = n.noteNum();
+        if ((nn < 0) || (nn >= (NoteNum) candidate_table_.size())) {
+            return no_candidates_;
+        }
+        return candidate_table_[nn];
+    }
 
     /*! \brief Return the note number for a given fret position.
      */
     Note noteAt(const FretPos& fp);
 
+    const InstrumentStringList& strings() const {return strings_;}  /*!< Gettor function for the strings */
+
 protected:
+    /*! \brief Rebuild the table used by candidates().
+     *
+     * Subclasses must call this after changing strings_.
+     */
+    void buildCandidateTable();
+
     InstrumentStringList strings_;
 
+private:
+    std::vector<FretPosList> candidate_table_;  /*!< Indexed by note number */
+    FretPosList no_candidates_;
+
 };
 
 }
@@ -2,26 +2,86 @@
 
 #include <holdsworth/musicxmlloader.h>
 #include <holdsworth/musicxmlreader.h>
+#include <holdsworth/musicxmlparser.h>
+#include <holdsworth/mxlarchive.h>
+#include <holdsworth/trace.h>
 #include <QFile>
+#include <QBuffer>
 #include <QDebug>
 
 namespace Holdsworth {
 
-void loadMusicXML(QString filename, NoteList& nl, bool force, int& key_sig, int offset)
+namespace {
+
+/*
+ * Target is a NoteList or a Score. The notes are read into a new one, and
+ * only added to target if the file could be read.
+ */
+template <class Target>
+void load(QString filename, Target& target, bool force, int& key_sig, int offset)
 {
     QFile file(filename);
     if ( file.open( QIODevice::ReadOnly) ) {
+        /*
+         * Map the file if we can, so the fast parser can work on it where it
+         * is; otherwise read it all in.
+         */
+        QByteArray contents;
+        qint64 size = file.size();
+        const char *data = reinterpret_cast<const char *>(file.map(0, size));
+        if (data == 0) {
+            contents = file.readAll();
+            data = contents.constData();
+            size = contents.size();
+        }
 
+        /*
+         * A compressed score is inflated in memory, rather than to a file.
+         */
+        QByteArray inflated;
+        if (isMxl(data, size)) {
+            QString error;
+            if (!readMxl(data, size, inflated, error)) {
+                qDebug() << "Can't read" << filename << ":" << error;
+                file.close();
+                return;
+            }
+            data = inflated.constData();
+            size = inflated.size();
+        }
 
-        MusicXMLReader reader(nl);
-        reader.setForced(force);
-        reader.setOffset(offset);
+        Target parsed;
+        ScoreBuilder builder(parsed);
+        MusicXMLParser parser(builder);
+        parser.setForced(force);
+        parser.setOffset(offset);
 
-        if (!reader.read(&file)) {
-            qDebug("Badly-formed input XML");
+        if (parser.parse(data, size)) {
+            key_sig = parser.keySig();
+            target.insert(target.end(), parsed.begin(), parsed.end());
         }
         else {
-            key_sig = reader.keySig();
+            /*
+             * Leave the difficult cases to the full XML reader.
+             */
+            TRACE(TraceDetail) << "Fast MusicXML parse failed: " << parser.errorString().toStdString() << std::endl;
+            QBuffer buffer;
+            buffer.setData(data, size);
+            buffer.open(QIODevice::ReadOnly);
+
+            Target read;
+            ScoreBuilder read_builder(read);
+            MusicXMLReader reader(read_builder);
+            reader.setForced(force);
+            reader.setOffset(offset);
+
+            if (!reader.read(&buffer)) {
+                qDebug("Badly-formed input XML");
+            }
+            else {
+                key_sig = reader.keySig();
+                target.insert(target.end(), read.begin(), read.end());
+            }
         }
 
         file.close();
@@ -33,6 +93,18 @@ void loadMusicXML(QString filename, NoteList& nl, bool force, int& key_sig, int
 
 }
 
+void loadMusicXML(QString filename, NoteList& nl, bool force, int& key_sig, int offset)
+{
+    load(filename, nl, force, key_sig, offset);
+}
+
+void loadMusicXML(QString filename, Score& score, bool force, int& key_sig, int offset)
+{
+    load(filename, score, force, key_sig, offset);
+}
+
+}
+
 
 /*
  * End
@@ -5,11 +5,22 @@
 
 #include <QString>
 #include <holdsworth/note.h>
+#include <holdsworth/score.h>
 
 namespace Holdsworth {
 
+/*!
+ * \brief Append the notes of every part of a MusicXML file to nl, in the
+ * order they appear in the file.
+ */
 void loadMusicXML(QString filename, NoteList& nl, bool force, int& key_sig, int offset);
 
+/*!
+ * \brief Append a list of notes to score for each voice of each part of a
+ * MusicXML file.
+ */
+void loadMusicXML(QString filename, Score& score, bool force, int& key_sig, int offset);
+
 
 }
 
@@ -0,0 +1,578 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#include <holdsworth/musicxmlparser.h>
+#include <holdsworth/trace.h>
+#include <QDebug>
+#include <cstring>
+
+
+namespace Holdsworth {
+
+namespace {
+
+#define PATH_LEN(path) (sizeof(path) / sizeof((path)[0]))
+
+    inline bool isSpace(char c)
+    {
+        return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+    }
+
+    /*!
+     * \brief Read the number in [p, end), allowing spaces around it.
+     *
+     * Like QString::toInt(), anything that isn't a number reads as 0.
+     */
+    int readInt(const char *p, const char *end)
+    {
+        while ((p < end) && isSpace(*p)) {
+            ++p;
+        }
+        bool negative = false;
+        if ((p < end) && ((*p == '-') || (*p == '+'))) {
+            negative = (*p == '-');
+            ++p;
+        }
+        if ((p == end) || (*p < '0') || (*p > '9')) {
+            return 0;
+        }
+        int value = 0;
+        while ((p < end) && (*p >= '0') && (*p <= '9')) {
+            value = (value * 10) + (*p - '0');
+            ++p;
+        }
+        while ((p < end) && isSpace(*p)) {
+            ++p;
+        }
+        if (p != end) {
+            return 0;
+        }
+        return negative ? -value : value;
+    }
+
+    /*!
+     * \brief Find the value of the named attribute in [p, end), which has
+     * already been checked to have its quotes matched.
+     *
+     * On success, value points at the opening quote.
+     */
+    bool findAttribute(const char *p, const char *end, const char *name, const char *& value)
+    {
+        int len = std::strlen(name);
+        while (p < end) {
+            while ((p < end) && isSpace(*p)) {
+                ++p;
+            }
+            const char *n = p;
+            while ((p < end) && (*p != '=') && !isSpace(*p)) {
+                ++p;
+            }
+            bool match = ((p - n) == len) && (std::memcmp(n, name, len) == 0);
+            while ((p < end) && (isSpace(*p) || (*p == '='))) {
+                ++p;
+            }
+            if ((p == end) || ((*p != '"') && (*p != '\''))) {
+                return false;
+            }
+            if (match) {
+                value = p;
+                return true;
+            }
+            p = static_cast<const char *>(std::memchr(p + 1, *p, end - p - 1)) + 1;
+        }
+        return false;
+    }
+
+    /*!
+     * \brief MIDI note of the given step in octave 3, or 0 if it isn't one.
+     */
+    int stepNote(char step)
+    {
+        switch (step) {
+        case 'C': return 36;
+        case 'D': return 38;
+        case 'E': return 40;
+        case 'F': return 41;
+        case 'G': return 43;
+        case 'A': return 45;
+        case 'B': return 47;
+        default:  return 0;
+        }
+    }
+}
+
+MusicXMLParser::MusicXMLParser(ScoreBuilder& builder)
+    : builder_(builder)
+    , notelist_(builder.noteList())
+    , defn_()
+    , forced_(false)
+    , offset_(0)
+    , key_sig_(0)
+    , resolution_(960)
+    , step_(0)
+    , octave_(0)
+    , alter_(0)
+    , fret_(0)
+    , open_()
+    , begin_(0)
+    , p_(0)
+    , end_(0)
+    , error_()
+{
+}
+
+void
+MusicXMLParser::setForced(bool force)
+{
+    forced_ = force;
+}
+
+void
+MusicXMLParser::setOffset(int offset)
+{
+    offset_ = offset;
+}
+
+bool
+MusicXMLParser::isFlatKey() const
+{
+    return (key_sig_ < 0);
+}
+
+int
+MusicXMLParser::keySig() const
+{
+    return key_sig_;
+}
+
+QString
+MusicXMLParser::errorString() const
+{
+    return error_;
+}
+
+MusicXMLParser::Element
+MusicXMLParser::intern(const char *name, int len)
+{
+    struct Name {
+        const char  *text;
+        int         len;
+        Element     el;
+    };
+
+    /*
+     * Roughly in order of how often they turn up.
+     */
+    static const Name names[] = {
+        { "note", 4, ElNote },
+        { "duration", 8, ElDuration },
+        { "pitch", 5, ElPitch },
+        { "step", 4, ElStep },
+        { "octave", 6, ElOctave },
+        { "alter", 5, ElAlter },
+        { "rest", 4, ElRest },
+        { "voice", 5, ElVoice },
+        { "notations", 9, ElNotations },
+        { "technical", 9, ElTechnical },
+        { "fret", 4, ElFret },
+        { "string", 6, ElString },
+        { "measure", 7, ElMeasure },
+        { "attributes", 10, ElAttributes },
+        { "divisions", 9, ElDivisions },
+        { "key", 3, ElKey },
+        { "fifths", 6, ElFifths },
+        { "part", 4, ElPart },
+        { "score-partwise", 14, ElScorePartwise }
+    };
+
+    for (unsigned int i = 0; i < PATH_LEN(names); ++i) {
+        if ((names[i].len == len) && (std::memcmp(names[i].text, name, len) == 0)) {
+            return names[i].el;
+        }
+    }
+    return ElOther;
+}
+
+/*!
+ * \brief Are the open elements exactly the given path from the root?
+ */
+bool
+MusicXMLParser::at(const Element *path, unsigned int len) const
+{
+    if (open_.size() != len) {
+        return false;
+    }
+    for (unsigned int i = len; i-- > 0; ) {
+        if (open_[i].el != path[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+MusicXMLParser::fail(const char *msg)
+{
+    error_ = QString(msg) + " at byte " + QString::number((qint64) (p_ - begin_));
+    return false;
+}
+
+/*!
+ * \brief Move p_ to just after the next occurrence of marker.
+ */
+bool
+MusicXMLParser::skipPast(const char *marker)
+{
+    int len = std::strlen(marker);
+    while (p_ + len <= end_) {
+        const char *q = static_cast<const char *>(std::memchr(p_, marker[0], end_ - p_));
+        if ((q == 0) || (q + len > end_)) {
+            break;
+        }
+        if (std::memcmp(q, marker, len) == 0) {
+            p_ = q + len;
+            return true;
+        }
+        p_ = q + 1;
+    }
+    p_ = end_;
+    return fail("Unterminated markup");
+}
+
+bool
+MusicXMLParser::parse(const char *data, qint64 size)
+{
+    begin_ = data;
+    p_ = data;
+    end_ = data + size;
+    open_.clear();
+    open_.reserve(16);
+    error_ = QString();
+
+    if ((size >= 2)
+        && ((((uchar) data[0] == 0xfe) && ((uchar) data[1] == 0xff))
+            || (((uchar) data[0] == 0xff) && ((uchar) data[1] == 0xfe))))
+    {
+        return fail("UTF-16 input is not supported");
+    }
+    if ((size >= 3) && ((uchar) data[0] == 0xef) && ((uchar) data[1] == 0xbb) && ((uchar) data[2] == 0xbf)) {
+        /* UTF-8 byte order mark */
+        p_ += 3;
+    }
+
+    bool seen_root = false;
+
+    while (p_ < end_) {
+        if (*p_ != '<') {
+            const char *t = p_;
+            const char *q = static_cast<const char *>(std::memchr(p_, '<', end_ - p_));
+            p_ = (q == 0) ? end_ : q;
+            if (!open_.empty()) {
+                text(t, p_);
+            }
+            continue;
+        }
+
+        ++p_;
+        if (p_ == end_) {
+            return fail("Unexpected end of file");
+        }
+
+        if (*p_ == '?') {
+            /* XML declaration or processing instruction */
+            if (!skipPast("?>")) {
+                return false;
+            }
+        }
+        else if (*p_ == '!') {
+            if ((end_ - p_ >= 3) && (std::memcmp(p_, "!--", 3) == 0)) {
+                if (!skipPast("-->")) {
+                    return false;
+                }
+            }
+            else if ((end_ - p_ >= 8) && (std::memcmp(p_, "![CDATA[", 8) == 0)) {
+                const char *t = p_ + 8;
+                if (!skipPast("]]>")) {
+                    return false;
+                }
+                if (!open_.empty()) {
+                    text(t, p_ - 3);
+                }
+            }
+            else {
+                /*
+                 * DOCTYPE, possibly with an internal subset, which isn't
+                 * followed.
+                 */
+                int brackets = 0;
+                while ((p_ < end_) && ((*p_ != '>') || (brackets > 0))) {
+                    if ((*p_ == '"') || (*p_ == '\'')) {
+                        const char *q = static_cast<const char *>(std::memchr(p_ + 1, *p_, end_ - p_ - 1));
+                        if (q == 0) {
+                            return fail("Unterminated declaration");
+                        }
+                        p_ = q;
+                    }
+                    else if (*p_ == '[') {
+                        ++brackets;
+                    }
+                    else if (*p_ == ']') {
+                        --brackets;
+                    }
+                    ++p_;
+                }
+                if (p_ == end_) {
+                    return fail("Unterminated declaration");
+                }
+                ++p_;
+            }
+        }
+        else if (*p_ == '/') {
+            const char *name = ++p_;
+            while ((p_ < end_) && (*p_ != '>') && !isSpace(*p_)) {
+                ++p_;
+            }
+            int len = p_ - name;
+            const char *q = static_cast<const char *>(std::memchr(p_, '>', end_ - p_));
+            if (q == 0) {
+                return fail("Unterminated end tag");
+            }
+            p_ = q + 1;
+            if (!endElement(name, len)) {
+                return false;
+            }
+        }
+        else {
+            const char *name = p_;
+            while ((p_ < end_) && (*p_ != '>') && (*p_ != '/') && !isSpace(*p_)) {
+                ++p_;
+            }
+            int len = p_ - name;
+
+            /*
+             * Skip the attributes; startElement() can look back for the
+             * ones it wants.
+             */
+            const char *attrs = p_;
+            while ((p_ < end_) && (*p_ != '>')) {
+                if ((*p_ == '"') || (*p_ == '\'')) {
+                    const char *q = static_cast<const char *>(std::memchr(p_ + 1, *p_, end_ - p_ - 1));
+                    if (q == 0) {
+                        return fail("Unterminated attribute value");
+                    }
+                    p_ = q;
+                }
+                ++p_;
+            }
+            if (p_ == end_) {
+                return fail("Unterminated start tag");
+            }
+            bool empty = (p_[-1] == '/');
+            const char *attrs_end = empty ? (p_ - 1) : p_;
+            ++p_;
+
+            if (open_.empty()) {
+                if (seen_root) {
+                    return fail("More than one root element");
+                }
+                seen_root = true;
+            }
+            if (!startElement(name, len, attrs, attrs_end)) {
+                return false;
+            }
+            if (empty && !endElement(name, len)) {
+                return false;
+            }
+        }
+    }
+
+    if (!seen_root) {
+        return fail("No root element");
+    }
+    if (!open_.empty()) {
+        return fail("Unexpected end of file");
+    }
+    return true;
+}
+
+/*
+ * The elements we read are only looked at where MusicXMLReader would find
+ * them. Anything anywhere else is skipped.
+ */
+bool
+MusicXMLParser::startElement(const char *name, int len, const char *attrs, const char *attrs_end)
+{
+    static const Element part_path[] = { ElScorePartwise, ElPart };
+    static const Element note_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote };
+    static const Element rest_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElRest };
+    static const Element pitch_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElPitch };
+    static const Element technical_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElNotations, ElTechnical };
+
+    if (len == 0) {
+        return fail("Missing element name");
+    }
+
+    OpenElement e;
+    e.el = intern(name, len);
+    e.name = name;
+    e.len = len;
+
+    if (open_.empty() && (e.el != ElScorePartwise)) {
+        return fail("The file is not a MusicXML file?!");
+    }
+    open_.push_back(e);
+
+    if (at(note_path, PATH_LEN(note_path))) {
+        builder_.startNote();
+    }
+    else if (at(rest_path, PATH_LEN(rest_path))) {
+        notelist_.push_back(Note(0));
+    }
+    else if (at(pitch_path, PATH_LEN(pitch_path))) {
+        step_ = 0;
+        octave_ = 0;
+        alter_ = 0;
+    }
+    else if (at(technical_path, PATH_LEN(technical_path))) {
+        fret_ = 0;
+    }
+    else if (at(part_path, PATH_LEN(part_path))) {
+        std::string id;
+        const char *a;
+        if (findAttribute(attrs, attrs_end, "id", a)) {
+            const char *q = static_cast<const char *>(std::memchr(a + 1, *a, attrs_end - a - 1));
+            id.assign(a + 1, q);
+        }
+        builder_.startPart(id);
+    }
+    return true;
+}
+
+bool
+MusicXMLParser::endElement(const char *name, int len)
+{
+    static const Element pitch_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElPitch };
+    static const Element note_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote };
+
+    if (open_.empty()
+        || (open_.back().len != len)
+        || (std::memcmp(open_.back().name, name, len) != 0))
+    {
+        return fail("Mismatched end tag");
+    }
+
+    if (at(pitch_path, PATH_LEN(pitch_path))) {
+        notelist_.push_back(Note(stepNote(step_) + (12 * (octave_ - 3)) + alter_ + offset_));
+    }
+    else if (at(note_path, PATH_LEN(note_path))) {
+        builder_.endNote();
+    }
+
+    open_.pop_back();
+    return true;
+}
+
+/*!
+ * \brief Deal with the text [begin, end) in the innermost open element.
+ */
+void
+MusicXMLParser::text(const char *begin, const char *end)
+{
+    static const Element divisions_path[] = { ElScorePartwise, ElPart, ElMeasure, ElAttributes, ElDivisions };
+    static const Element fifths_path[] = { ElScorePartwise, ElPart, ElMeasure, ElAttributes, ElKey, ElFifths };
+    static const Element duration_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElDuration };
+    static const Element voice_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElVoice };
+    static const Element step_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElPitch, ElStep };
+    static const Element octave_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElPitch, ElOctave };
+    static const Element alter_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElPitch, ElAlter };
+    static const Element fret_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElNotations, ElTechnical, ElFret };
+    static const Element string_path[] = { ElScorePartwise, ElPart, ElMeasure, ElNote, ElNotations, ElTechnical, ElString };
+
+    switch (open_.back().el) {
+    case ElDuration:
+        if (at(duration_path, PATH_LEN(duration_path)) && !notelist_.empty()) {
+            uint duration = readInt(begin, end);
+            notelist_.back().setDuration(((960 * duration) + 480) / resolution_);
+        }
+        break;
+
+    case ElVoice:
+        if (at(voice_path, PATH_LEN(voice_path))) {
+            builder_.setVoice(readInt(begin, end));
+        }
+        break;
+
+    case ElStep:
+        if (at(step_path, PATH_LEN(step_path))) {
+            while ((begin < end) && isSpace(*begin)) {
+                ++begin;
+            }
+            step_ = (begin < end) ? *begin : 0;
+        }
+        break;
+
+    case ElOctave:
+        if (at(octave_path, PATH_LEN(octave_path))) {
+            octave_ = readInt(begin, end);
+        }
+        break;
+
+    case ElAlter:
+        if (at(alter_path, PATH_LEN(alter_path))) {
+            alter_ = readInt(begin, end);
+        }
+        break;
+
+    case ElFret:
+        if (at(fret_path, PATH_LEN(fret_path))) {
+            fret_ = readInt(begin, end);
+        }
+        break;
+
+    case ElString:
+        if (at(string_path, PATH_LEN(string_path)) && !notelist_.empty()) {
+            /*
+             * Convert MusicXML string number to Holdsworth string number
+             */
+            uint stringnum = 7 - readInt(begin, end);
+            NoteNum n = defn_.noteAt(FretPos(stringnum, fret_)).noteNum();
+            if (notelist_.back().noteNum() != n) {
+                if (n == notelist_.back().noteNum() + 12) {
+                    qDebug() << "Octave Offset detected - consider using --note-offset=12 with this MusicXML source.";
+                }
+                else {
+                    qDebug() << "AAAGH f" << fret_ << " s " << stringnum << "=" << n << "when notes say" << notelist_.back().noteNum();
+                }
+                notelist_.back().setNoteNum(n);
+            }
+            if (forced_ && (fret_ != 0)) {
+                notelist_.back().setString(stringnum);
+            }
+        }
+        break;
+
+    case ElDivisions:
+        if (at(divisions_path, PATH_LEN(divisions_path))) {
+            uint resolution = readInt(begin, end);
+            if (resolution > 0) {
+                resolution_ = resolution;
+            }
+            TRACE(TraceDetail) << "File resolution: " << resolution_ << " per crotchet" << std::endl;
+        }
+        break;
+
+    case ElFifths:
+        if (at(fifths_path, PATH_LEN(fifths_path))) {
+            key_sig_ = readInt(begin, end);
+            TRACE(TraceDetail) << "File key sig : " << key_sig_ << std::endl;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+}
+/*
+ * End
+ */
@@ -0,0 +1,113 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+#ifndef HoldsworthMusicXMLParser_h
+#define HoldsworthMusicXMLParser_h
+
+#include <QString>
+#include <vector>
+#include <holdsworth/note.h>
+#include <holdsworth/instrumentdefn.h>
+#include <holdsworth/score.h>
+
+
+namespace Holdsworth {
+
+/*!
+ * \brief Fast reader for the parts of a MusicXML file that fing uses.
+ *
+ * Works straight from a buffer (normally a memory-mapped file) and only
+ * looks at divisions, key, note, pitch, rest, duration, voice and
+ * notations/technical, which are read just as MusicXMLReader reads them.
+ * Element names are looked up once each and numbers are read in place,
+ * so nothing is allocated per element or per piece of text.
+ *
+ * It understands plain UTF-8 XML without entities in the elements it
+ * reads. For anything else parse() fails, and MusicXMLReader can be
+ * used instead.
+ */
+class MusicXMLParser
+{
+public:
+    MusicXMLParser(ScoreBuilder& builder);
+
+    bool parse(const char *data, qint64 size);
+
+    void setForced(bool force);
+    void setOffset(int offset);
+
+    bool isFlatKey() const;
+    int keySig() const;
+
+    /*! \brief Why parse() failed.
+     */
+    QString errorString() const;
+
+private:
+    /*! \brief The element names that mean something to us.
+     */
+    enum Element {
+        ElOther,
+        ElScorePartwise,
+        ElPart,
+        ElMeasure,
+        ElAttributes,
+        ElDivisions,
+        ElKey,
+        ElFifths,
+        ElNote,
+        ElPitch,
+        ElStep,
+        ElAlter,
+        ElOctave,
+        ElRest,
+        ElDuration,
+        ElVoice,
+        ElNotations,
+        ElTechnical,
+        ElFret,
+        ElString
+    };
+
+    /*! \brief An element that has been started but not yet ended.
+     */
+    struct OpenElement {
+        Element     el;
+        const char  *name;      /*!< In the buffer, for matching the end tag */
+        int         len;
+    };
+
+    static Element intern(const char *name, int len);
+    bool at(const Element *path, unsigned int len) const;
+
+    bool startElement(const char *name, int len, const char *attrs, const char *attrs_end);
+    bool endElement(const char *name, int len);
+    void text(const char *begin, const char *end);
+
+    bool skipPast(const char *marker);
+    bool fail(const char *msg);
+
+    ScoreBuilder& builder_;
+    NoteList& notelist_;
+    InstrumentDefn defn_;       /*!< For the notes at fret/string positions */
+    bool forced_;
+    int offset_;
+    int key_sig_;
+    uint resolution_;
+
+    /*
+     * The pitch being read
+     */
+    char step_;
+    int octave_;
+    int alter_;
+    uint fret_;
+
+    std::vector<OpenElement> open_;
+    const char *begin_;
+    const char *p_;
+    const char *end_;
+    QString error_;
+};
+
+}
+
+#endif
@@ -7,10 +7,10 @@
 
 namespace Holdsworth {
 
-MusicXMLReader::MusicXMLReader(NoteList& nl)
-    : notelist_(nl)
+MusicXMLReader::MusicXMLReader(ScoreBuilder& builder)
+    : builder_(builder)
+    , notelist_(builder.noteList())
     , forced_(false)
-    , restart_hint_(false)
     , notemap_()
     , resolution_(960)
     , key_sig_(0)
@@ -108,6 +108,8 @@ void MusicXMLReader::readScore()
 
 void MusicXMLReader::readPart()
 {
+    builder_.startPart(attributes().value("id").toString().toStdString());
+
     while (!atEnd()) {
 	readNext();
 
@@ -200,6 +202,8 @@ void MusicXMLReader::readKey()
 
 void MusicXMLReader::readNote()
 {
+    builder_.startNote();
+
     while (!atEnd()) {
 	readNext();
 
@@ -216,15 +220,20 @@ void MusicXMLReader::readNote()
             }
             else if (name() == "rest") {
                 notelist_.push_back(Note(0));
-                restart_hint_ = true;
 		readUnknownElement();
             }
             else if (name() == "duration") {
                 readNext();
                 uint duration = text().toString().toUInt();
                 duration = ((960 * duration) + 480) / resolution_;
-qDebug() << "duration = " << duration;
-                notelist_.back().setDuration(duration);
+                if (!notelist_.empty()) {
+                    notelist_.back().setDuration(duration);
+                }
+		readUnknownElement();
+            }
+            else if (name() == "voice") {
+                readNext();
+                builder_.setVoice(text().toString().toInt());
 		readUnknownElement();
             }
 	    else {
@@ -232,6 +241,8 @@ qDebug() << "duration = " << duration;
             }
 	}
     }
+
+    builder_.endNote();
 }
 
 void MusicXMLReader::readPitch()
@@ -269,10 +280,6 @@ void MusicXMLReader::readPitch()
 	}
     }
     notelist_.push_back(Note(notemap_[notename] + (12 * octave) + tweak + offset_));
-    if (restart_hint_) {
-        restart_hint_ = false;
-        notelist_.back().addAnnotation(HINT_RESTART);
-    }
 }
 
 void MusicXMLReader::readNotations()
@@ -321,17 +328,19 @@ void MusicXMLReader::readTechnical()
                  */
                 stringnum = 7 - (text().toString().toUInt());
                 NoteNum n = t_defn.noteAt(FretPos(stringnum, fretnum)).noteNum();
-                if (notelist_.back().noteNum() != n) {
-                    if (n == notelist_.back().noteNum() + 12) {
-                        qDebug() << "Octave Offset detected - consider using --note-offset=12 with this MusicXML source.";
+                if (!notelist_.empty()) {
+                    if (notelist_.back().noteNum() != n) {
+                        if (n == notelist_.back().noteNum() + 12) {
+                            qDebug() << "Octave Offset detected - consider using --note-offset=12 with this MusicXML source.";
+                        }
+                        else {
+                            qDebug() << "AAAGH f" << fretnum << " s " << stringnum << "=" << n << "when notes say" << notelist_.back().noteNum();
+                        }
+                        notelist_.back().setNoteNum(n);
                     }
-                    else {
-                        qDebug() << "AAAGH f" << fretnum << " s " << stringnum << "=" << n << "when notes say" << notelist_.back().noteNum();
+                    if (forced_ && (fretnum != 0)) {
+                        notelist_.back().setString(stringnum);
                     }
-                    notelist_.back().setNoteNum(n);
-                }
-                if (forced_ && (fretnum != 0)) {
-                    notelist_.back().setString(stringnum);
                 }
 		readUnknownElement();
             }
@@ -5,6 +5,7 @@
 #include <QXmlStreamReader>
 #include <QMap>
 #include <holdsworth/note.h>
+#include <holdsworth/score.h>
 
 
 namespace Holdsworth {
@@ -12,7 +13,7 @@ namespace Holdsworth {
  class MusicXMLReader : public ::QXmlStreamReader
  {
  public:
-     MusicXMLReader(NoteList& nl);
+     MusicXMLReader(ScoreBuilder& builder);
 
      bool read(::QIODevice *device);
 
@@ -34,9 +35,9 @@ namespace Holdsworth {
      void readAttributes();
      void readKey();
 
+     ScoreBuilder& builder_;
      NoteList& notelist_;
      bool forced_;
-     bool restart_hint_;
      QMap<QString,uint> notemap_;
      uint resolution_;
      int key_sig_;
@@ -0,0 +1,261 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#include <holdsworth/mxlarchive.h>
+#include <zlib.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Holdsworth {
+
+namespace {
+
+    const quint32 zip_local_header_sig = 0x04034b50;
+    const quint32 zip_central_header_sig = 0x02014b50;
+    const quint32 zip_end_sig = 0x06054b50;
+
+    /*
+     * Fixed sizes of the zip records, before their variable length fields.
+     */
+    const qint64 zip_local_header_size = 30;
+    const qint64 zip_central_header_size = 46;
+    const qint64 zip_end_size = 22;
+
+    const int zip_stored = 0;
+    const int zip_deflated = 8;
+
+    /*
+     * An entry's size comes from the archive, so it is checked before
+     * anything is allocated for it: no score is anywhere near this big, and
+     * deflate can't shrink anything by more than about 1032 to 1.
+     */
+    const quint32 max_entry_size = 256 * 1024 * 1024;
+    const quint32 max_deflate_ratio = 1032;
+
+    const char container_name[] = "META-INF/container.xml";
+
+    inline quint32 get16(const char *p)
+    {
+        const uchar *u = reinterpret_cast<const uchar *>(p);
+        return u[0] | (u[1] << 8);
+    }
+
+    inline quint32 get32(const char *p)
+    {
+        const uchar *u = reinterpret_cast<const uchar *>(p);
+        return u[0] | (u[1] << 8) | (u[2] << 16) | ((quint32) u[3] << 24);
+    }
+
+    /*!
+     * \brief Where to find one file in the archive.
+     */
+    struct ZipEntry {
+        std::string     name;
+        int             method;
+        quint32         crc;
+        quint32         compressed_size;
+        quint32         size;
+        quint32         local_header;   /*!< Offset of the local file header */
+    };
+
+    bool readDirectory(const char *data, qint64 size, std::vector<ZipEntry>& entries, QString& error)
+    {
+        /*
+         * The end of central directory record is at the end, unless there
+         * is a comment after it.
+         */
+        const char *end = 0;
+        for (qint64 i = size - zip_end_size; (i >= 0) && (i >= size - zip_end_size - 0xffff); --i) {
+            if (get32(data + i) == zip_end_sig) {
+                end = data + i;
+                break;
+            }
+        }
+        if (end == 0) {
+            error = "Not a zip archive";
+            return false;
+        }
+
+        quint32 count = get16(end + 10);
+        quint32 dir_size = get32(end + 12);
+        quint32 dir_offset = get32(end + 16);
+        if ((dir_offset == 0xffffffff) || ((qint64) dir_offset + dir_size > size)) {
+            error = "Unsupported (zip64) or damaged zip archive";
+            return false;
+        }
+
+        const char *p = data + dir_offset;
+        const char *dir_end = p + dir_size;
+        for (quint32 i = 0; i < count; ++i) {
+            if ((p + zip_central_header_size > dir_end) || (get32(p) != zip_central_header_sig)) {
+                error = "Damaged zip directory";
+                return false;
+            }
+            quint32 name_len = get16(p + 28);
+            quint32 extra_len = get16(p + 30);
+            quint32 comment_len = get16(p + 32);
+            if (p + zip_central_header_size + name_len > dir_end) {
+                error = "Damaged zip directory";
+                return false;
+            }
+
+            ZipEntry e;
+            e.method = get16(p + 10);
+            e.crc = get32(p + 16);
+            e.compressed_size = get32(p + 20);
+            e.size = get32(p + 24);
+            e.local_header = get32(p + 42);
+            e.name.assign(p + zip_central_header_size, name_len);
+            entries.push_back(e);
+
+            p += zip_central_header_size + name_len + extra_len + comment_len;
+        }
+        return true;
+    }
+
+    bool extract(const char *data, qint64 size, const ZipEntry& e, QByteArray& out, QString& error)
+    {
+        QString what = QString::fromStdString(e.name) + ": ";
+
+        if ((e.size == 0xffffffff) || (e.compressed_size == 0xffffffff)) {
+            error = what + "zip64 entries are not supported";
+            return false;
+        }
+        if (((qint64) e.local_header + zip_local_header_size > size)
+            || (get32(data + e.local_header) != zip_local_header_sig))
+        {
+            error = what + "damaged zip entry";
+            return false;
+        }
+        const char *h = data + e.local_header;
+        qint64 start = e.local_header + zip_local_header_size + get16(h + 26) + get16(h + 28);
+        if (start + e.compressed_size > size) {
+            error = what + "damaged zip entry";
+            return false;
+        }
+        const char *in = data + start;
+
+        if ((e.size > max_entry_size)
+            || ((e.method == zip_deflated) && ((quint64) e.size > (quint64) e.compressed_size * max_deflate_ratio + 64)))
+        {
+            error = what + "entry too big (" + QString::number(e.size) + " bytes)";
+            return false;
+        }
+        out.resize(e.size);
+        if (e.method == zip_stored) {
+            if (e.compressed_size != e.size) {
+                error = what + "damaged zip entry";
+                return false;
+            }
+            std::memcpy(out.data(), in, e.size);
+        }
+        else if (e.method == zip_deflated) {
+            z_stream zs;
+            std::memset(&zs, 0, sizeof(zs));
+            /* Raw deflate data, without a zlib header */
+            if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+                error = what + "can't start inflating";
+                return false;
+            }
+            zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+            zs.avail_in = e.compressed_size;
+            zs.next_out = reinterpret_cast<Bytef *>(out.data());
+            zs.avail_out = e.size;
+            int rc = inflate(&zs, Z_FINISH);
+            inflateEnd(&zs);
+            if ((rc != Z_STREAM_END) || (zs.total_out != e.size)) {
+                error = what + "can't inflate";
+                return false;
+            }
+        }
+        else {
+            error = what + "unsupported compression method " + QString::number(e.method);
+            return false;
+        }
+
+        if (crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(out.constData()), e.size) != e.crc) {
+            error = what + "bad CRC";
+            return false;
+        }
+        return true;
+    }
+
+    /*!
+     * \brief The full-path of the first rootfile in container.xml.
+     */
+    std::string rootFile(const QByteArray& container)
+    {
+        std::string c(container.constData(), container.size());
+        std::string::size_type i = c.find("<rootfile");
+        if (i == std::string::npos) {
+            return std::string();
+        }
+        i = c.find("full-path", i);
+        if (i == std::string::npos) {
+            return std::string();
+        }
+        i = c.find_first_of("\"'", i);
+        if (i == std::string::npos) {
+            return std::string();
+        }
+        std::string::size_type j = c.find(c[i], i + 1);
+        if (j == std::string::npos) {
+            return std::string();
+        }
+        return c.substr(i + 1, j - i - 1);
+    }
+
+    bool endsWith(const std::string& s, const char *suffix)
+    {
+        std::string::size_type n = std::strlen(suffix);
+        return (s.size() >= n) && (s.compare(s.size() - n, n, suffix) == 0);
+    }
+}
+
+bool isMxl(const char *data, qint64 size)
+{
+    return (size >= 4) && (get32(data) == zip_local_header_sig);
+}
+
+bool readMxl(const char *data, qint64 size, QByteArray& xml, QString& error)
+{
+    std::vector<ZipEntry> entries;
+    if (!readDirectory(data, size, entries, error)) {
+        return false;
+    }
+
+    std::string root;
+    for (std::vector<ZipEntry>::const_iterator e = entries.begin(); e != entries.end(); ++e) {
+        if ((*e).name == container_name) {
+            QByteArray container;
+            if (!extract(data, size, *e, container, error)) {
+                return false;
+            }
+            root = rootFile(container);
+            break;
+        }
+    }
+
+    for (std::vector<ZipEntry>::const_iterator e = entries.begin(); e != entries.end(); ++e) {
+        bool is_root;
+        if (!root.empty()) {
+            is_root = ((*e).name == root);
+        }
+        else {
+            is_root = ((*e).name.compare(0, 9, "META-INF/") != 0)
+                && (endsWith((*e).name, ".xml") || endsWith((*e).name, ".musicxml"));
+        }
+        if (is_root) {
+            return extract(data, size, *e, xml, error);
+        }
+    }
+
+    error = root.empty() ? QString("No score in archive") : ("Score " + QString::fromStdString(root) + " not in archive");
+    return false;
+}
+
+}
+
+/*
+ * end
+ */
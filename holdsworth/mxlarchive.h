@@ -0,0 +1,35 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#ifndef HoldsworthMxlArchive_h
+#define HoldsworthMxlArchive_h
+
+#include <QString>
+#include <QByteArray>
+
+namespace Holdsworth {
+
+/*!
+ * \brief Does the buffer hold a zip archive, i.e. a compressed (.mxl)
+ * MusicXML file?
+ */
+bool isMxl(const char *data, qint64 size);
+
+/*!
+ * \brief Inflate the score from a compressed (.mxl) MusicXML file.
+ *
+ * The score is the first rootfile named by META-INF/container.xml, or
+ * failing that the first .xml or .musicxml file outside META-INF. Only
+ * stored and deflated entries are understood (not zip64.)
+ *
+ * \return false, with the reason in error, if the score can't be found or
+ * inflated.
+ */
+bool readMxl(const char *data, qint64 size, QByteArray& xml, QString& error);
+
+}
+
+#endif
+
+/*
+ * end
+ */
@@ -19,6 +19,7 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <qglobal.h>
 #include "note.h"
 #include <qstring.h>
 
@@ -40,60 +41,88 @@
 
 namespace Holdsworth {
 
+    Q_STATIC_ASSERT(sizeof(Note) == 16);
 
     Note::Note()
-	: note_num_(0)
-	, duration_(240)
+	: duration_(240)
 	, time_(NotDefined)
-	, f_()
+	, note_num_(0)
+	, annotation_(ANNO_NONE)
+	, strg_(NotDefined)
+	, fret_(NotDefined)
+	, finger_(NoFingerDefined)
     {
     }
 
     Note::Note(NoteNum the_note_num)
-	: note_num_(the_note_num)
-	, duration_(240)
+	: duration_(240)
 	, time_(NotDefined)
-	, f_()
+	, note_num_(the_note_num)
+	, annotation_(ANNO_NONE)
+	, strg_(NotDefined)
+	, fret_(NotDefined)
+	, finger_(NoFingerDefined)
     {
     }
 
     Note::Note(NoteNum the_note_num, int the_duration, int the_time)
-	: note_num_(the_note_num)
-	, duration_(the_duration)
+	: duration_(the_duration)
 	, time_(the_time)
-	, f_()
+	, note_num_(the_note_num)
+	, annotation_(ANNO_NONE)
+	, strg_(NotDefined)
+	, fret_(NotDefined)
+	, finger_(NoFingerDefined)
     {
     }
 
+    Fingering Note::fingering() const
+    {
+        Fingering f;
+        f.strg = strg_;
+        f.fret = fret_;
+        f.finger = (FingerNum) finger_;
+        f.annotation = (Annotation) annotation_;
+        return f;
+    }
+
+    void Note::setFingering(const Fingering& x)
+    {
+        strg_ = x.strg;
+        fret_ = x.fret;
+        finger_ = x.finger;
+        annotation_ = x.annotation;
+    }
+
     void Note::purgeAutoHints()
     {
-        if (f_.hasAnnotation(ANNO_AUTOHINT)) {
-            f_.annotation = ANNO_NONE;
+        if (hasAnnotation(ANNO_AUTOHINT)) {
+            annotation_ = ANNO_NONE;
         }
     }
 
     bool Note::hasGlissHint() const
     {
-        return (f_.hasAnnotation(HINT_GLISS));
+        return (hasAnnotation(HINT_GLISS));
     }
 
     bool Note::hasShiftHint() const
     {
-        return (f_.hasAnnotation(HINT_SHIFT_UP)
-                || f_.hasAnnotation(HINT_SHIFT_DOWN));
+        return (hasAnnotation(HINT_SHIFT_UP)
+                || hasAnnotation(HINT_SHIFT_DOWN));
     }
 
     bool Note::hasRestartHint() const
     {
-        return (f_.hasAnnotation(HINT_RESTART));
+        return (hasAnnotation(HINT_RESTART));
     }
 
     bool Note::hasBreakHint() const
     {
-        return (f_.hasAnnotation(HINT_SHIFT_UP)
-                || f_.hasAnnotation(HINT_SHIFT_DOWN)
-                || f_.hasAnnotation(HINT_RESTART)
-                || f_.hasAnnotation(HINT_BREAK)
+        return (hasAnnotation(HINT_SHIFT_UP)
+                || hasAnnotation(HINT_SHIFT_DOWN)
+                || hasAnnotation(HINT_RESTART)
+                || hasAnnotation(HINT_BREAK)
                 );
     }
 
@@ -123,21 +152,21 @@ namespace Holdsworth {
 	QString s;
 
 
-	if (f_.hasAnnotation(HINT_RESTART	)) s += STRING_HINT_RESTART;
-	if (f_.hasAnnotation(HINT_SHIFT_UP	)) s += STRING_HINT_SHIFT_UP;
-	if (f_.hasAnnotation(HINT_SHIFT_DOWN	)) s += STRING_HINT_SHIFT_DOWN;
-	if (f_.hasAnnotation(HINT_GLISS		)) s += STRING_HINT_GLISS;
-	if (f_.hasAnnotation(HINT_BREAK		)) s += STRING_HINT_BREAK;
-	if (f_.hasAnnotation(ANNO_AUTOHINT	)) s += STRING_ANNO_AUTOHINT;
-	if (f_.hasAnnotation(ANNO_STRETCH	)) s += STRING_ANNO_STRETCH;
-	if (f_.hasAnnotation(ANNO_SHIFT		)) s += STRING_ANNO_SHIFT;
-	if (f_.hasAnnotation(ANNO_LAYOVER	)) s += STRING_ANNO_LAYOVER;
-	if (f_.hasAnnotation(ANNO_BADCHANGE	)) s += STRING_ANNO_BADCHANGE;
-	if (f_.hasAnnotation(ANNO_BADSTRETCH	)) s += STRING_ANNO_BADSTRETCH;
-	if (f_.hasAnnotation(ANNO_QSHIFT	)) s += STRING_ANNO_QSHIFT;
-	if (f_.hasAnnotation(ANNO_TMOVE  	)) s += STRING_ANNO_TMOVE;
-	if (f_.hasAnnotation(ANNO_OMOVE  	)) s += STRING_ANNO_OMOVE;
-	if (f_.hasAnnotation(ANNO_AMOVE  	)) s += STRING_ANNO_AMOVE;
+	if (hasAnnotation(HINT_RESTART	)) s += STRING_HINT_RESTART;
+	if (hasAnnotation(HINT_SHIFT_UP	)) s += STRING_HINT_SHIFT_UP;
+	if (hasAnnotation(HINT_SHIFT_DOWN	)) s += STRING_HINT_SHIFT_DOWN;
+	if (hasAnnotation(HINT_GLISS		)) s += STRING_HINT_GLISS;
+	if (hasAnnotation(HINT_BREAK		)) s += STRING_HINT_BREAK;
+	if (hasAnnotation(ANNO_AUTOHINT	)) s += STRING_ANNO_AUTOHINT;
+	if (hasAnnotation(ANNO_STRETCH	)) s += STRING_ANNO_STRETCH;
+	if (hasAnnotation(ANNO_SHIFT		)) s += STRING_ANNO_SHIFT;
+	if (hasAnnotation(ANNO_LAYOVER	)) s += STRING_ANNO_LAYOVER;
+	if (hasAnnotation(ANNO_BADCHANGE	)) s += STRING_ANNO_BADCHANGE;
+	if (hasAnnotation(ANNO_BADSTRETCH	)) s += STRING_ANNO_BADSTRETCH;
+	if (hasAnnotation(ANNO_QSHIFT	)) s += STRING_ANNO_QSHIFT;
+	if (hasAnnotation(ANNO_TMOVE  	)) s += STRING_ANNO_TMOVE;
+	if (hasAnnotation(ANNO_OMOVE  	)) s += STRING_ANNO_OMOVE;
+	if (hasAnnotation(ANNO_AMOVE  	)) s += STRING_ANNO_AMOVE;
 
 	if (s.isEmpty()) {
 	    return std::string();
@@ -155,9 +184,9 @@ namespace Holdsworth {
 		note_num_,
 		duration_,
 		time_,
-		f_.strg,
-		f_.fret,
-		f_.finger);
+		strg_,
+		fret_,
+		finger_);
 
         d += QString(annotationAsStr().c_str());
 
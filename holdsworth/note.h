@@ -25,7 +25,8 @@
 
 #include <holdsworth/types.h>
 #include <string>
-#include <list>
+#include <vector>
+#include <map>
 
 namespace Holdsworth {
 
@@ -35,6 +36,10 @@ namespace Holdsworth {
  * The library consumer can pass in note data with explicit fingering data.
  * Such data is always honoured by the engine; i.e. it overrides any auto-computed
  * data and will affect fingering of later notes.
+ *
+ * Notes are copied a great deal by the engine, so this is kept as a small,
+ * trivially copyable record. Anything bulky (such as fret diagrams) is kept
+ * in a side table, see FretDiagramMap.
  */
 class Note
 {
@@ -48,42 +53,36 @@ public:
     /*!< Normal constructor for a note.*/
     Note(NoteNum the_note_num, int the_duration, int the_time);
 
-    virtual ~Note() {/*empty*/}
-
     std::string dbgDump() const;
 
     int duration() const {return duration_;}
+    int time() const {return time_;}                    /*!< Gettor function for start time */
 
     NoteNum noteNum() const {return note_num_;}         /*!< Gettor function for MIDI note number */
-    StringNum stringNum() const {return f_.strg;}       /*!< Gettor function for string number */
-    FingerNum fingerNum() const {return f_.finger;}     /*!< Gettor function for fingering */
-    FretNum fretNum() const {return f_.fret;}           /*!< Gettor function for fret */
-    Fingering fingering() const {return f_;}            /*!< Gettor function for whole fingering struct */
-    Annotation annotation() const {return f_.annotation;}  	/*!< Gettor function for annotation */
+    StringNum stringNum() const {return strg_;}         /*!< Gettor function for string number */
+    FingerNum fingerNum() const {return (FingerNum) finger_;}   /*!< Gettor function for fingering */
+    FretNum fretNum() const {return fret_;}             /*!< Gettor function for fret */
+    Fingering fingering() const;                        /*!< Gettor function for whole fingering struct */
+    Annotation annotation() const {return (Annotation) annotation_;}  	/*!< Gettor function for annotation */
     std::string annotationAsStr() const;  			/*!< Gettor function for annotation */
-    std::string lilypondDiagram() const {return fretdiagram_;}
 
-    void setFinger(FingerNum x) {f_.finger = x;}        /*!< Settor function for fingering */
-    void setFret(FretNum x) {f_.fret = x;}              /*!< Settor function for fret number */
-    void setString(StringNum x) {f_.strg = x;}          /*!< Settor function for string */
-    void setFingering(const Fingering& x) {f_ = x;}     /*!< Quick settor function for fq fingering */
+    void setFinger(FingerNum x) {finger_ = x;}          /*!< Settor function for fingering */
+    void setFret(FretNum x) {fret_ = x;}                /*!< Settor function for fret number */
+    void setString(StringNum x) {strg_ = x;}            /*!< Settor function for string */
+    void setFingering(const Fingering& x);              /*!< Quick settor function for fq fingering */
     void setNoteNum (NoteNum n) {note_num_ = n;}        /*!< Settor function for MIDI note number */
 
     bool isRest() const {return note_num_ == 0;}        /*!< Is this note a rest? */
 
-    bool hasAnnotation(const Annotation x) const {return ((f_.annotation & x) != 0);}
+    bool hasAnnotation(const Annotation x) const {return ((annotation_ & x) != 0);}
     /*! \brief Add an annotation mark to the note.
      */
-    void addAnnotation(const Annotation x) {f_.annotation = (Annotation) (f_.annotation | x);}
+    void addAnnotation(const Annotation x) {annotation_ |= x;}
 
     /*! \brief Set duration in MusicXML units (Assuming 960 = crotchet)
      */
     void setDuration(int d) {duration_ = d;}
 
-    /*! \brief Associate a Lilypond fretboard diagram with this note position.
-     */
-    void setDiagram(const std::string& x) {fretdiagram_ = x;}
-
     /*! \brief Remove any autohints added to the note.
      *
      * \todo this has a bug: If there are any autohints, <b>all</b> hints are removed.
@@ -108,21 +107,30 @@ public:
 
     static Annotation annotationFromStr(const std::string& a);
 private:
-    NoteNum note_num_;
     int duration_;
     int time_;
-
-    Fingering f_;
-    std::string fretdiagram_;
+    short note_num_;
+    unsigned short annotation_;
+    signed char strg_;
+    signed char fret_;
+    signed char finger_;
 };
 
 /*! \brief An ordered list of Notes.
+ *
+ * This is contiguous, so it can be indexed and iterators into it can be
+ * moved any distance in constant time.
  */
-typedef std::list<Note> NoteList;
+typedef std::vector<Note> NoteList;
 
 /*! \brief An iterator into a list of Notes. (Convenience typedef)
  */
 typedef NoteList::const_iterator ConstNoteIterator;
 
+/*! \brief Lilypond fret diagrams for some of the notes in a NoteList,
+ * keyed by index.
+ */
+typedef std::map<unsigned int, std::string> FretDiagramMap;
+
 }
 #endif /* HOLDSWORTH_NOTE_H */
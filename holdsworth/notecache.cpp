@@ -0,0 +1,254 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#include <holdsworth/notecache.h>
+#include <holdsworth/trace.h>
+#include <QFile>
+#include <QDir>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <cstring>
+
+namespace Holdsworth {
+
+namespace {
+
+    /*
+     * Read back on another byte order, the magic number doesn't match.
+     */
+    const quint32 cache_magic = 0x434e5748;     /* "HWNC" */
+    const quint32 cache_version = 1;
+
+    struct CacheHeader {
+        quint32     magic;
+        quint32     version;
+        quint32     note_size;
+        qint32      key_sig;
+        quint32     num_parts;
+    };
+
+    /*
+     * Followed by the id, padded to keep the notes aligned, then the notes.
+     */
+    struct CachePart {
+        qint32      voice;
+        quint32     id_len;
+        quint32     num_notes;
+    };
+
+    inline quint64 padded(quint64 len)
+    {
+        return (len + 3) & ~(quint64) 3;
+    }
+
+    /*!
+     * \brief One part to be written to the cache.
+     */
+    struct PartRef {
+        PartRef(const std::string& i, int v, const NoteList& n) : id(i), voice(v), notes(n) {}
+
+        const std::string&  id;
+        int                 voice;
+        const NoteList&     notes;
+    };
+
+    void write(const QString& path, const std::vector<PartRef>& parts, int key_sig)
+    {
+        /*
+         * Written under another name and renamed into place, so that a fing
+         * reading the same entry never sees half of it.
+         */
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qDebug() << "Can't write note cache" << path << ":" << file.errorString();
+            return;
+        }
+
+        CacheHeader h;
+        h.magic = cache_magic;
+        h.version = cache_version;
+        h.note_size = sizeof(Note);
+        h.key_sig = key_sig;
+        h.num_parts = parts.size();
+        file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+
+        static const char pad[4] = { 0, 0, 0, 0 };
+        for (std::vector<PartRef>::const_iterator i = parts.begin(); i != parts.end(); ++i) {
+            CachePart p;
+            p.voice = (*i).voice;
+            p.id_len = (*i).id.size();
+            p.num_notes = (*i).notes.size();
+            file.write(reinterpret_cast<const char *>(&p), sizeof(p));
+            file.write((*i).id.data(), p.id_len);
+            file.write(pad, padded(p.id_len) - p.id_len);
+            if (p.num_notes > 0) {
+                file.write(reinterpret_cast<const char *>(&(*i).notes[0]), p.num_notes * sizeof(Note));
+            }
+        }
+
+        if (!file.commit()) {
+            qDebug() << "Can't write note cache" << path << ":" << file.errorString();
+        }
+    }
+
+    /*!
+     * \brief Read a whole cache entry into score; false if it isn't there,
+     * or isn't one we can use.
+     */
+    bool read(const QString& path, Score& score, int& key_sig)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        qint64 size = file.size();
+        if (size < (qint64) sizeof(CacheHeader)) {
+            return false;
+        }
+
+        QByteArray contents;
+        const char *data = reinterpret_cast<const char *>(file.map(0, size));
+        if (data == 0) {
+            contents = file.readAll();
+            data = contents.constData();
+            size = contents.size();
+        }
+        const char *end = data + size;
+
+        CacheHeader h;
+        std::memcpy(&h, data, sizeof(h));
+        if ((h.magic != cache_magic) || (h.version != cache_version) || (h.note_size != sizeof(Note))) {
+            TRACE(TraceDetail) << "Ignoring note cache " << path.toStdString() << " from another version" << std::endl;
+            return false;
+        }
+
+        Score parts;
+        const char *p = data + sizeof(h);
+        for (quint32 i = 0; i < h.num_parts; ++i) {
+            CachePart cp;
+            if (end - p < (qint64) sizeof(cp)) {
+                return false;
+            }
+            std::memcpy(&cp, p, sizeof(cp));
+            p += sizeof(cp);
+            quint64 left = end - p;
+            if ((left < padded(cp.id_len)) || (left - padded(cp.id_len) < (quint64) cp.num_notes * sizeof(Note)))
+            {
+                return false;
+            }
+
+            parts.push_back(ScorePart());
+            ScorePart& part = parts.back();
+            part.id.assign(p, cp.id_len);
+            part.voice = cp.voice;
+            p += padded(cp.id_len);
+            part.notes.resize(cp.num_notes);
+            if (cp.num_notes > 0) {
+                std::memcpy(&part.notes[0], p, cp.num_notes * sizeof(Note));
+            }
+            p += cp.num_notes * sizeof(Note);
+        }
+        if (p != end) {
+            return false;
+        }
+
+        score.swap(parts);
+        key_sig = h.key_sig;
+        return true;
+    }
+}
+
+NoteCache::NoteCache(const QString& dir)
+    : dir_(dir)
+    , path_()
+{
+}
+
+bool
+NoteCache::setInput(const QString& filename, const QString& options)
+{
+    path_ = QString();
+    if (dir_.isEmpty()) {
+        return true;
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(options.toUtf8());
+    hash.addData("\0", 1);
+
+    qint64 size = file.size();
+    const char *data = reinterpret_cast<const char *>(file.map(0, size));
+    if (data != 0) {
+        hash.addData(data, size);
+    }
+    else if (!hash.addData(&file)) {
+        return false;
+    }
+
+    if (!QDir().mkpath(dir_)) {
+        qDebug() << "Can't make note cache directory" << dir_;
+        return true;
+    }
+    path_ = QDir(dir_).filePath(QString::fromLatin1(hash.result().toHex()) + ".notes");
+    return true;
+}
+
+bool
+NoteCache::load(Score& score, int& key_sig) const
+{
+    if (path_.isEmpty() || !read(path_, score, key_sig)) {
+        return false;
+    }
+    TRACE(TraceProgress) << "Notes read from cache " << path_.toStdString() << std::endl;
+    return true;
+}
+
+bool
+NoteCache::load(NoteList& nl, int& key_sig) const
+{
+    Score score;
+    int k;
+    if (path_.isEmpty() || !read(path_, score, k) || (score.size() != 1)) {
+        return false;
+    }
+    TRACE(TraceProgress) << "Notes read from cache " << path_.toStdString() << std::endl;
+    nl.swap(score[0].notes);
+    key_sig = k;
+    return true;
+}
+
+void
+NoteCache::store(const Score& score, int key_sig) const
+{
+    if (path_.isEmpty() || score.empty()) {
+        return;
+    }
+    std::vector<PartRef> parts;
+    for (Score::const_iterator i = score.begin(); i != score.end(); ++i) {
+        parts.push_back(PartRef((*i).id, (*i).voice, (*i).notes));
+    }
+    write(path_, parts, key_sig);
+}
+
+void
+NoteCache::store(const NoteList& nl, int key_sig) const
+{
+    if (path_.isEmpty() || nl.empty()) {
+        return;
+    }
+    std::string no_id;
+    std::vector<PartRef> parts;
+    parts.push_back(PartRef(no_id, 1, nl));
+    write(path_, parts, key_sig);
+}
+
+}
+
+/*
+ * end
+ */
@@ -0,0 +1,65 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#ifndef HoldsworthNoteCache_h
+#define HoldsworthNoteCache_h
+
+#include <QString>
+#include <holdsworth/note.h>
+#include <holdsworth/score.h>
+
+namespace Holdsworth {
+
+/*!
+ * \brief A directory of input files that have already been read, so that
+ * fingering the same file again needn't parse it again.
+ *
+ * Each entry is a small binary file holding the key signature and the
+ * notes of every part exactly as they are laid out in memory, so reading
+ * one back is a map and a copy. Entries are named by a hash of the input
+ * file's contents and of anything else that changes how it is read (the
+ * format and the options), so an edited file or a different option simply
+ * misses the cache.
+ *
+ * The entries are only good for the machine (and build) that wrote them;
+ * one written elsewhere is ignored and replaced.
+ */
+class NoteCache
+{
+public:
+    /*! \brief A cache in dir, which is created if need be. An empty dir
+     * means no cache: load() always misses and store() does nothing.
+     */
+    explicit NoteCache(const QString& dir);
+
+    /*! \brief Name the input that is about to be read.
+     *
+     * options should describe everything else that affects what is read
+     * from it.
+     *
+     * \return false if the input can't be read.
+     */
+    bool setInput(const QString& filename, const QString& options);
+
+    /*! \brief Read the input's notes from the cache, if they are there.
+     */
+    bool load(Score& score, int& key_sig) const;
+    bool load(NoteList& nl, int& key_sig) const;
+
+    /*! \brief Save the notes read from the input. Nothing is saved for an
+     * input with no notes, which is most likely one that couldn't be read.
+     */
+    void store(const Score& score, int key_sig) const;
+    void store(const NoteList& nl, int key_sig) const;
+
+private:
+    QString dir_;
+    QString path_;      /*!< Of the entry for the input, if there is one */
+};
+
+}
+
+#endif
+
+/*
+ * end
+ */
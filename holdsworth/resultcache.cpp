@@ -0,0 +1,352 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+/***************************************************************************
+ *   Copyright (C) 2006 by Vince Negri                                     *
+ *   vince.negri@gmail.com                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "resultcache.h"
+#include <holdsworth/trace.h>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QMutexLocker>
+#include <QDebug>
+#include <cstring>
+
+namespace Holdsworth {
+
+    /*
+     * Read back on another byte order, the magic number doesn't match.
+     */
+    static const quint32 result_magic = 0x43525748;    /* "HWRC" */
+    static const quint32 result_version = 1;
+
+    /*!
+     * \brief Start of a result cache file.
+     */
+    struct ResultHeader {
+        quint32     magic;
+        quint32     version;
+        quint32     note_size;
+        qint32      cost;
+        quint32     shifts;
+        quint32     num_notes;
+        quint32     num_diagrams;
+    };
+
+    /*!
+     * \brief One fret diagram in a result cache file, after the notes.
+     * Followed by the text of the diagram.
+     */
+    struct ResultDiagram {
+        quint32     index;
+        quint32     len;
+    };
+
+    /*!
+     * \brief Rough size in memory of a cache entry.
+     */
+    static unsigned long entryBytes(const std::string& key, const CachedResult& r)
+    {
+        unsigned long bytes = sizeof(CachedResult) + 64 + (2 * key.size()) + (r.output.size() * sizeof(Note));
+        for (FretDiagramMap::const_iterator d = r.diagrams.begin(); d != r.diagrams.end(); ++d) {
+            bytes += 48 + (*d).second.size();
+        }
+        return bytes;
+    }
+
+    static const char result_suffix[] = ".result";
+
+    ResultCache::ResultCache(unsigned long max_memory)
+        : mutex_()
+        , lru_()
+        , index_()
+        , max_memory_(max_memory)
+        , dir_()
+        , max_disk_(0)
+        , disk_(0)
+        , trimming_(false)
+        , stats_()
+    {
+    }
+
+    void ResultCache::setMaxMemory(unsigned long bytes)
+    {
+        QMutexLocker lock(&mutex_);
+        max_memory_ = bytes;
+        trimMemory();
+    }
+
+    void ResultCache::setDirectory(const QString& dir, qint64 max_disk)
+    {
+        {
+            QMutexLocker lock(&mutex_);
+            dir_ = QString();
+            max_disk_ = max_disk;
+            if (dir.isEmpty()) {
+                return;
+            }
+            if (!QDir().mkpath(dir)) {
+                qDebug() << "Can't make result cache directory" << dir;
+                return;
+            }
+            dir_ = dir;
+        }
+        trimDisk();
+    }
+
+    bool ResultCache::find(const std::string& key, CachedResult& result)
+    {
+        QString dir;
+        {
+            QMutexLocker lock(&mutex_);
+            ++stats_.lookups;
+
+            std::map<std::string, EntryList::iterator>::iterator i = index_.find(key);
+            if (i != index_.end()) {
+                lru_.splice(lru_.begin(), lru_, (*i).second);
+                result = (*(*i).second).result;
+                ++stats_.hits;
+                return true;
+            }
+            dir = dir_;
+        }
+
+        if (dir.isEmpty() || !readDisk(dir, key, result)) {
+            return false;
+        }
+
+        QMutexLocker lock(&mutex_);
+        keep(key, result);
+        ++stats_.hits;
+        ++stats_.disk_hits;
+        return true;
+    }
+
+    void ResultCache::insert(const std::string& key, const CachedResult& result)
+    {
+        QString dir;
+        {
+            QMutexLocker lock(&mutex_);
+            ++stats_.stores;
+            keep(key, result);
+            dir = dir_;
+        }
+        if (dir.isEmpty()) {
+            return;
+        }
+
+        qint64 size = writeDisk(dir, key, result);
+        bool trim;
+        {
+            QMutexLocker lock(&mutex_);
+            disk_ += size;
+            trim = (disk_ > max_disk_);
+        }
+        if (trim) {
+            trimDisk();
+        }
+    }
+
+    ResultCacheStatistics ResultCache::statistics() const
+    {
+        QMutexLocker lock(&mutex_);
+        return stats_;
+    }
+
+    void ResultCache::keep(const std::string& key, const CachedResult& result)
+    {
+        std::map<std::string, EntryList::iterator>::iterator i = index_.find(key);
+        if (i != index_.end()) {
+            stats_.memory -= (*(*i).second).bytes;
+            --stats_.entries;
+            lru_.erase((*i).second);
+            index_.erase(i);
+        }
+
+        lru_.push_front(Entry());
+        Entry& e = lru_.front();
+        e.key = key;
+        e.result = result;
+        e.bytes = entryBytes(key, result);
+        index_[key] = lru_.begin();
+        stats_.memory += e.bytes;
+        ++stats_.entries;
+
+        trimMemory();
+    }
+
+    void ResultCache::trimMemory()
+    {
+        while ((stats_.memory > max_memory_) && !lru_.empty()) {
+            Entry& e = lru_.back();
+            stats_.memory -= e.bytes;
+            --stats_.entries;
+            ++stats_.evictions;
+            index_.erase(e.key);
+            lru_.pop_back();
+        }
+    }
+
+    void ResultCache::trimDisk()
+    {
+        /*
+         * One thread trimming is enough; the others carry on.
+         */
+        QString dir;
+        qint64 max_disk;
+        {
+            QMutexLocker lock(&mutex_);
+            if (trimming_ || dir_.isEmpty()) {
+                return;
+            }
+            trimming_ = true;
+            dir = dir_;
+            max_disk = max_disk_;
+        }
+
+        qint64 left = trimDir(dir, max_disk);
+
+        QMutexLocker lock(&mutex_);
+        trimming_ = false;
+        if (dir == dir_) {
+            disk_ = left;
+        }
+    }
+
+    QString ResultCache::diskPath(const QString& dir, const std::string& key)
+    {
+        return QDir(dir).filePath(QString::fromStdString(key) + result_suffix);
+    }
+
+    bool ResultCache::readDisk(const QString& dir, const std::string& key, CachedResult& result)
+    {
+        QFile file(diskPath(dir, key));
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        QByteArray contents = file.readAll();
+        const char *p = contents.constData();
+        const char *end = p + contents.size();
+
+        ResultHeader h;
+        if (end - p < (qint64) sizeof(h)) {
+            return false;
+        }
+        std::memcpy(&h, p, sizeof(h));
+        p += sizeof(h);
+        if ((h.magic != result_magic) || (h.version != result_version) || (h.note_size != sizeof(Note))) {
+            TRACE(TraceDetail) << "Ignoring result cache " << diskPath(dir, key).toStdString() << " from another version" << std::endl;
+            return false;
+        }
+        if ((quint64) (end - p) < (quint64) h.num_notes * sizeof(Note)) {
+            return false;
+        }
+
+        CachedResult r;
+        r.cost = h.cost;
+        r.shifts = h.shifts;
+        r.output.resize(h.num_notes);
+        if (h.num_notes > 0) {
+            std::memcpy(&r.output[0], p, h.num_notes * sizeof(Note));
+        }
+        p += h.num_notes * sizeof(Note);
+
+        for (quint32 i = 0; i < h.num_diagrams; ++i) {
+            ResultDiagram d;
+            if (end - p < (qint64) sizeof(d)) {
+                return false;
+            }
+            std::memcpy(&d, p, sizeof(d));
+            p += sizeof(d);
+            if ((quint64) (end - p) < d.len) {
+                return false;
+            }
+            r.diagrams[d.index].assign(p, d.len);
+            p += d.len;
+        }
+        if (p != end) {
+            return false;
+        }
+
+        result = r;
+        return true;
+    }
+
+    qint64 ResultCache::writeDisk(const QString& dir, const std::string& key, const CachedResult& result)
+    {
+        /*
+         * Written under another name and renamed into place, so that
+         * another process or thread never reads half of it.
+         */
+        QSaveFile file(diskPath(dir, key));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qDebug() << "Can't write result cache" << diskPath(dir, key) << ":" << file.errorString();
+            return 0;
+        }
+
+        ResultHeader h;
+        h.magic = result_magic;
+        h.version = result_version;
+        h.note_size = sizeof(Note);
+        h.cost = result.cost;
+        h.shifts = result.shifts;
+        h.num_notes = result.output.size();
+        h.num_diagrams = result.diagrams.size();
+        qint64 size = file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        if (h.num_notes > 0) {
+            size += file.write(reinterpret_cast<const char *>(&result.output[0]), h.num_notes * sizeof(Note));
+        }
+        for (FretDiagramMap::const_iterator d = result.diagrams.begin(); d != result.diagrams.end(); ++d) {
+            ResultDiagram rd;
+            rd.index = (*d).first;
+            rd.len = (*d).second.size();
+            size += file.write(reinterpret_cast<const char *>(&rd), sizeof(rd));
+            size += file.write((*d).second.data(), rd.len);
+        }
+
+        if (!file.commit()) {
+            qDebug() << "Can't write result cache" << diskPath(dir, key) << ":" << file.errorString();
+            return 0;
+        }
+        return size;
+    }
+
+    qint64 ResultCache::trimDir(const QString& dir, qint64 max_disk)
+    {
+        /*
+         * Other processes may be using the directory too, so count it
+         * afresh rather than trusting disk_.
+         */
+        QFileInfoList files = QDir(dir).entryInfoList(QStringList(QString("*") + result_suffix),
+                QDir::Files, QDir::Time | QDir::Reversed);
+        qint64 disk = 0;
+        for (QFileInfoList::const_iterator f = files.begin(); f != files.end(); ++f) {
+            disk += (*f).size();
+        }
+        for (QFileInfoList::const_iterator f = files.begin(); (f != files.end()) && (disk > max_disk); ++f) {
+            qint64 size = (*f).size();
+            if (QFile::remove((*f).filePath())) {
+                disk -= size;
+            }
+        }
+        return disk;
+    }
+
+}
@@ -0,0 +1,150 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+/***************************************************************************
+ *   Copyright (C) 2006 by Vince Negri                                     *
+ *   vince.negri@gmail.com                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef HOLDSWORTH_RESULTCACHE_H
+#define HOLDSWORTH_RESULTCACHE_H
+
+#include <holdsworth/note.h>
+#include <QString>
+#include <QMutex>
+#include <string>
+#include <list>
+#include <map>
+
+namespace Holdsworth {
+
+/*! \brief A finished fingering, as kept by a ResultCache.
+ */
+struct CachedResult {
+    CachedResult() : output(), diagrams(), cost(0), shifts(0) {}
+
+    NoteList            output;
+    FretDiagramMap      diagrams;
+    int                 cost;
+    unsigned int        shifts;
+};
+
+/*! \brief Counters for a ResultCache, since it was made.
+ */
+struct ResultCacheStatistics {
+    ResultCacheStatistics()
+        : lookups(0)
+        , hits(0)
+        , disk_hits(0)
+        , stores(0)
+        , evictions(0)
+        , entries(0)
+        , memory(0)
+        {}
+
+    /*! \brief Fraction of lookups that were hits, in memory or on disk.
+     */
+    double hitRate() const {return (lookups == 0) ? 0.0 : ((double) hits / lookups);}
+
+    unsigned int lookups;
+    unsigned int hits;          /*!< Including disk_hits */
+    unsigned int disk_hits;     /*!< Hits that had to be read from disk */
+    unsigned int stores;
+    unsigned int evictions;     /*!< Entries dropped from memory to stay under the limit */
+    unsigned int entries;       /*!< In memory now */
+    unsigned long memory;       /*!< Bytes (roughly) in memory now */
+};
+
+/*! \brief Finished fingerings, keyed by everything that went into them.
+ *
+ * An Engine given one with Engine::setResultCache() looks up each
+ * compute() before doing any work, and adds the result afterwards, so a
+ * repeat of an earlier request costs a lookup and a copy.
+ *
+ * Entries are kept in memory, least recently used first out when they go
+ * over the size limit. If a directory is given they are also written
+ * there, one file each, and looked for there on a miss in memory; the
+ * directory is trimmed (oldest files first) to its own size limit, and
+ * can be shared by several processes.
+ *
+ * One cache can be shared by engines in different threads. Only the
+ * in-memory entries are looked at under its lock; files are read, written
+ * and trimmed outside it, so one thread's disk work doesn't hold up the
+ * others.
+ */
+class ResultCache
+{
+public:
+    /*! \brief A cache holding up to max_memory bytes in memory.
+     */
+    explicit ResultCache(unsigned long max_memory = dflt_max_memory);
+
+    void setMaxMemory(unsigned long bytes);
+
+    /*! \brief Keep entries in dir as well, up to max_disk bytes of them.
+     * An empty dir keeps them only in memory.
+     */
+    void setDirectory(const QString& dir, qint64 max_disk);
+
+    /*! \brief Look up the result with the given key.
+     */
+    bool find(const std::string& key, CachedResult& result);
+
+    /*! \brief Keep a result. Anything already kept under the key is
+     * replaced.
+     */
+    void insert(const std::string& key, const CachedResult& result);
+
+    ResultCacheStatistics statistics() const;
+
+    static const unsigned long dflt_max_memory = 64 * 1024 * 1024;
+
+private:
+    struct Entry {
+        std::string     key;
+        CachedResult    result;
+        unsigned long   bytes;
+    };
+
+    /*! \brief Most recently used first.
+     */
+    typedef std::list<Entry> EntryList;
+
+    void keep(const std::string& key, const CachedResult& result);
+    void trimMemory();
+    void trimDisk();
+
+    /*
+     * These only touch the files in dir, so are called without mutex_.
+     */
+    static QString diskPath(const QString& dir, const std::string& key);
+    static bool readDisk(const QString& dir, const std::string& key, CachedResult& result);
+    static qint64 writeDisk(const QString& dir, const std::string& key, const CachedResult& result);
+    static qint64 trimDir(const QString& dir, qint64 max_disk);
+
+    mutable QMutex      mutex_;
+    EntryList           lru_;
+    std::map<std::string, EntryList::iterator> index_;
+    unsigned long       max_memory_;
+    QString             dir_;
+    qint64              max_disk_;
+    qint64              disk_;          /*!< Bytes in dir_, as far as we know */
+    bool                trimming_;      /*!< A thread is trimming dir_ */
+    ResultCacheStatistics stats_;
+};
+
+}
+#endif /* HOLDSWORTH_RESULTCACHE_H */
@@ -0,0 +1,94 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#include <holdsworth/score.h>
+
+namespace Holdsworth {
+
+ScorePart::ScorePart()
+    : id()
+    , voice(1)
+    , notes()
+    , output()
+    , diagrams()
+    , stats()
+    , ok(false)
+{
+}
+
+ScoreBuilder::ScoreBuilder(NoteList& nl)
+    : single_(&nl)
+    , score_(0)
+    , index_()
+    , part_()
+    , voice_(1)
+    , note_()
+{
+}
+
+ScoreBuilder::ScoreBuilder(Score& score)
+    : single_(0)
+    , score_(&score)
+    , index_()
+    , part_()
+    , voice_(1)
+    , note_()
+{
+}
+
+void ScoreBuilder::startPart(const std::string& id)
+{
+    part_ = id;
+}
+
+void ScoreBuilder::startNote()
+{
+    note_.clear();
+    voice_ = 1;
+}
+
+void ScoreBuilder::setVoice(int voice)
+{
+    voice_ = voice;
+}
+
+NoteList& ScoreBuilder::destination()
+{
+    if (single_ != 0) {
+        return *single_;
+    }
+
+    std::pair<std::string, int> key(part_, voice_);
+    std::map<std::pair<std::string, int>, unsigned int>::const_iterator i = index_.find(key);
+    if (i != index_.end()) {
+        return (*score_)[(*i).second].notes;
+    }
+
+    index_[key] = score_->size();
+    score_->push_back(ScorePart());
+    score_->back().id = part_;
+    score_->back().voice = voice_;
+    return score_->back().notes;
+}
+
+void ScoreBuilder::endNote()
+{
+    if (note_.empty()) {
+        return;
+    }
+
+    NoteList& nl = destination();
+    for (ConstNoteIterator ni = note_.begin(); ni != note_.end(); ++ni) {
+        bool after_rest = !nl.empty() && nl.back().isRest();
+        nl.push_back(*ni);
+        if (after_rest && !(*ni).isRest()) {
+            nl.back().addAnnotation(HINT_RESTART);
+        }
+    }
+    note_.clear();
+}
+
+}
+
+/*
+ * end
+ */
@@ -0,0 +1,80 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#ifndef HoldsworthScore_h
+#define HoldsworthScore_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <holdsworth/note.h>
+#include <holdsworth/engine.h>
+
+namespace Holdsworth {
+
+/*!
+ * \brief The notes of one voice of one part of a score, and their fingering.
+ */
+struct ScorePart {
+    ScorePart();
+
+    std::string         id;         /*!< MusicXML part id */
+    int                 voice;
+    NoteList            notes;      /*!< Input */
+    NoteList            output;     /*!< Filled in by Engine::computeScore() */
+    FretDiagramMap      diagrams;
+    EngineStatistics    stats;
+    bool                ok;
+};
+
+/*!
+ * \brief A score that has been split up into lines that can each be
+ * fingered on their own.
+ */
+typedef std::vector<ScorePart> Score;
+
+/*!
+ * \brief Collects the notes read from a score, either into a single
+ * list in the order they were read, or into one list per part and voice.
+ *
+ * The reader puts the notes of each <note> element into noteList(),
+ * between startNote() and endNote().
+ */
+class ScoreBuilder
+{
+public:
+    explicit ScoreBuilder(NoteList& nl);
+    explicit ScoreBuilder(Score& score);
+
+    /*! \brief Where the notes of the current <note> go.
+     */
+    NoteList& noteList() {return note_;}
+
+    void startPart(const std::string& id);
+    void startNote();
+    void setVoice(int voice);
+
+    /*! \brief Move the notes of the current <note> to the end of the list
+     * for its part and voice.
+     *
+     * The first note after a rest in each list gets a restart hint.
+     */
+    void endNote();
+
+private:
+    NoteList& destination();
+
+    NoteList            *single_;
+    Score               *score_;
+    std::map<std::pair<std::string, int>, unsigned int> index_;    /*!< Of parts in score_ */
+    std::string         part_;
+    int                 voice_;
+    NoteList            note_;
+};
+
+}
+
+#endif
+
+/*
+ * end
+ */
@@ -0,0 +1,113 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#include <holdsworth/textloader.h>
+#include <holdsworth/instrumentdefn.h>
+#include <holdsworth/trace.h>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QDebug>
+
+namespace Holdsworth {
+
+bool loadTextNotes(QString filename, NoteList& nl, InstrumentDefn& defn, TextFormat format)
+{
+    QFile file(filename);
+    if ( file.open( QIODevice::ReadOnly) ) {
+        QTextStream stream( &file );
+        QString line;
+        while ( !stream.atEnd() ) {
+            QString whole_line;
+
+            int i;
+            QString note_annotation;
+            QString note_type;
+
+            if (format == MidiCsv) {
+                whole_line = stream.readLine();
+                QStringList sl = whole_line.split(',');
+                // For now..
+                if (sl.count() < 6) {
+                        note_type = "x";
+                }
+                else if ((sl[2] == " Note_on_c") && (sl[5] != " 0")) {
+                        note_type = "M";
+                        i = sl[4].toInt();
+                }
+                else {
+                        note_type = "x";
+                }
+                note_annotation = ".";
+            }
+            else if (format == DumbTab) {
+                stream >> note_type;
+                stream >> i;
+                stream >> note_annotation;
+            }
+            else {
+                stream >> note_type;
+                stream >> i;
+                stream >> note_annotation;
+            }
+
+            stream.skipWhiteSpace();
+            if (note_type == "x") {
+                    ;
+            }
+            else if (note_type == "M") {
+                if (tracing(TraceDetail)) {
+                    qDebug() << "read Midi note" <<  i << note_annotation;
+                }
+                nl.push_back(Note(i));
+            }
+            else {
+                if (tracing(TraceDetail)) {
+                    qDebug() << "read note" << note_type << i << note_annotation;
+                }
+                nl.push_back(defn.noteAt(FretPos(note_type.toUInt(), i)));
+            }
+
+            if (format == DumbTab) {
+                uint stn = note_type.toUInt();
+                nl.back().setString(stn);
+
+            }
+
+            if (note_annotation.startsWith("1")) {
+                nl.back().setFinger(FirstFinger);
+                note_annotation.remove("1");
+            }
+            else if (note_annotation.startsWith("2")) {
+                nl.back().setFinger(MiddleFinger);
+                note_annotation.remove("2");
+            }
+            else if (note_annotation.startsWith("3")) {
+                nl.back().setFinger(RingFinger);
+                note_annotation.remove("3");
+            }
+            else if (note_annotation.startsWith("4")) {
+                nl.back().setFinger(FourthFinger);
+                note_annotation.remove("4");
+            }
+
+            if (note_annotation != ".") {
+                nl.back().addAnnotation(
+                        Note::annotationFromStr(
+                            std::string(note_annotation.toLatin1().data())));
+            }
+        }
+        file.close();
+        return true;
+    }
+    else {
+        qDebug() << "Can't open" << filename;
+        return false;
+    }
+}
+
+}
+
+
+/*
+ * End
+ */
@@ -0,0 +1,36 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+
+#ifndef HoldsworthTextLoader_h
+#define HoldsworthTextLoader_h
+
+#include <QString>
+#include <holdsworth/note.h>
+
+namespace Holdsworth {
+
+class InstrumentDefn;
+
+/*!
+ * \brief Layouts of plain text input files.
+ */
+enum TextFormat {
+    TextNotes,      /*!< "string fret annotation" per note, or "M midinote annotation" */
+    DumbTab,        /*!< As TextNotes, but the string is mandated */
+    MidiCsv         /*!< Output of midicsv; note-on events only */
+};
+
+/*!
+ * \brief Append the notes in a text file to nl.
+ *
+ * \return false if the file can't be opened.
+ */
+bool loadTextNotes(QString filename, NoteList& nl, InstrumentDefn& defn, TextFormat format);
+
+
+}
+
+#endif
+
+/*
+ * end
+ */
@@ -0,0 +1,81 @@
+/* vim: set ts=8 sts=4 sw=4 expandtab: */
+/***************************************************************************
+ *   Copyright (C) 2006 by Vince Negri                                     *
+ *   vince.negri@gmail.com                                                 *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef HOLDSWORTH_TRACE_H
+#define HOLDSWORTH_TRACE_H
+
+#include <iostream>
+
+/*! \brief The most detailed trace level that is compiled in at all.
+ *
+ * Trace statements above this level cost nothing, not even a test of the
+ * trace level, so the default leaves out the note-by-note workings of the
+ * inner loops. Build with DEFINES+=HOLDSWORTH_MAX_TRACE=3 to get them.
+ */
+#ifndef HOLDSWORTH_MAX_TRACE
+#define HOLDSWORTH_MAX_TRACE 2
+#endif
+
+namespace Holdsworth {
+
+/*!
+ * \brief How much the library says about what it is doing.
+ */
+enum TraceLevel {
+    TraceNone = 0,          /*!< Nothing but errors */
+    TraceProgress = 1,      /*!< Pass-by-pass progress, on stdout (the default) */
+    TraceDetail = 2,        /*!< Chunk-by-chunk decisions, on stderr */
+    TraceDebug = 3          /*!< Note-by-note workings, on stderr */
+};
+
+extern int trace_level;
+
+/*! \brief Set how much the library says. Not to be called during a compute().
+ */
+void setTraceLevel(int level);
+
+/*! \brief Is anything at the given level to be traced?
+ */
+inline bool tracing(int level)
+{
+    return (level <= HOLDSWORTH_MAX_TRACE) && (level <= trace_level);
+}
+
+/*! \brief Where anything at the given level is traced to.
+ */
+inline std::ostream& traceStream(int level)
+{
+    return (level <= TraceProgress) ? std::cout : std::cerr;
+}
+
+}
+
+/*!
+ * \brief Trace at the given level, e.g.
+ *
+ *     TRACE(TraceDetail) << "Chunk cost = " << c << std::endl;
+ *
+ * Nothing after TRACE() is evaluated unless the level is being traced.
+ */
+#define TRACE(level) \
+    if (!Holdsworth::tracing(level)) {} else Holdsworth::traceStream(level)
+
+#endif /* HOLDSWORTH_TRACE_H */
@@ -21,145 +21,53 @@
 
 #include "vn_algorithm.h"
 #include "instrumentdefn.h"
-#include "handmodel.h"
 #include "debugging.h"
+#include "trace.h"
 
 namespace Holdsworth {
 
-    /*! \brief The bonus assigned to adding a new note to a chunk.
-     * 
-     * This must always outweigh the "typical" cost of a note, or you will get
-     * silly results.
-     *
-     * The bigger the bonus (the more negative the value), the more Holdsworth
-     * will favour awkward finger moves that allow you stay in one position for
-     * longer.
-     */
-    const int vn_note_bonus = -5;
-
-    /*! \brief The maximum cost that can borne on a single note before it becomes worth
-     * trying to break position.
-     *
-     * If the cost passes this level, we try position shifts instead.
-     * where we currently are. It may turn out that staying in the same
-     * position is still best.
-     */
-    const int vn_position_break_threshold = 15;
-
-    /*! \brief The maximum cost that can be accumulated before it becomes worth
-     * trying to break position.
-     *
-     * If the cost passes this level, we look afresh for a best position from
-     * where we currently are. It may turn out that staying in the same
-     * position is still best.
-     */
-    //const int vn_cumulative_position_break_threshold = 20;
-
-    /*! \brief The penalty assigned to changing strings.
-     */
-    const int vn_string_change = 1;
-
-    /*! \brief The penalty assigned to a Q-shift (using the "wrong" finger for
-     * a note)
-     */
-    const int vn_q_shift_penalty = 5;
-
-    /*! \brief The penalty assigned to a T-move (transferring a finger between
-     * strings on successive notes, higher string to lower string)
-     */
-    const int vn_t_move_penalty = 10;
-
-
-    /*! \brief The penalty assigned to a traditional layover.
-     */
-    const int vn_layover_penalty = 2;
-    
-    /*! \brief The penalty assigned to an O-move (transferring a finger between
-     * strings on successive notes, lower string to higher string)
-     *
-     * An O-move is a sort of sliding layover, so is easier than a T-move.
-     */
-    const int vn_o_move_penalty = 10;
-
-    /*! \brief The penalty assigned to an A-move (transferring a finger between
-     * notes on successive notes, same string, but <b>without</b> a slur effect)
-     */
-    const int vn_a_move_penalty = 10;
-
-    /*! \brief The penalty assigned to an awkward position change fingering.
-     */
-    const int vn_bad_pos_change_penalty = 10;
-    
     /*!
-     * Chunk generation
-     * 
-     * \todo Parts of this could (and should) be refactored into the superclass
+     * Fingering of the first note in a chunk, including the penalties for the
+     * way in which we arrived at the new position.
      */
-    Chunk VNAlgorithm::generateChunk(ConstNoteIterator cni,
-                                        const FingerPosition &start_p,
-                                        const FretPos &start_fp,
+    template <class Hand>
+    bool VNAlgorithmT<Hand>::startFingering(const FingerPosition &start_p,
+                                        const Fingering *lead_in,
                                         const Fingering& force_first,
-                                        const Note *lead_in)
+                                        Fingering& f,
+                                        int& cost)
     {
-#ifdef EXTRA_DEBUG
-        qDebug("VNAlgorithm::generateChunk");
-        qDebug("Starting Note = %s" , (*cni).dbgDump().c_str());
-        qDebug("Starting LH Position: %d", start_p);
-        qDebug("Starting Fretboard Position: string=%d fret=%d", start_fp.strg, start_fp.fret);
-        if (lead_in != 0) {
-            qDebug("Lead-in note = %s", lead_in->dbgDump().c_str());
-        }
-#endif  
-        Chunk c;
-        c.setPosition(start_p);
-
-        /*
-         * Create the first note
-         */
-         /*! \todo copy in time
-         */
-
-        Note n((*cni).noteNum());
-        n.setDuration((*cni).duration());
-        n.addAnnotation((*cni).annotation());
-
-        FretNum f = start_fp.fret;
-
         /*
          * Determine which finger is being used for this note.
          */
-        FingerNum finger = handmodel_->getFinger(f, start_p);
+        FingerNum finger = Hand::getFinger(f.fret, start_p);
 
         /*
          * Nasty hack to enable the starting finger of a chunk to be mandated.
          * This should be handled higher up.
          */
         if ((force_first.finger != NoFingerDefined) && (force_first.finger != finger)) {
-            c.addCost(100000); /* Make sure this chunk isn't chosen!! */
-            return c;
+            return false;
         }
 
         Q_ASSERT(finger != NoFingerDefined);
 
-        n.setFinger(finger);
-        n.setFret(f);
-        n.setString(start_fp.strg);
+        f.finger = finger;
 
-        Fingering current_fingering;
-        Fingering init_fingering = n.fingering();
+        Fingering init_fingering = f;
         /*
          * First, inherent fingering penalties (stretch, weak finger)
          */
-        c.addCost(handmodel_->cost(init_fingering, start_p));
-        if (handmodel_->isStretch(init_fingering.fret, start_p)) {
-            n.addAnnotation(ANNO_STRETCH);
+        cost = Hand::cost(init_fingering, start_p, weights_);
+        if (Hand::isStretch(init_fingering.fret, start_p)) {
+            f.addAnnotation(ANNO_STRETCH);
         }
 
         /*
          * Position change.
          */
         if (lead_in != 0) {
-            current_fingering = lead_in->fingering();
+            const Fingering& current_fingering = *lead_in;
 
             /*
              * Penalties that accrue from awkward ways to change
@@ -170,22 +78,22 @@ namespace Holdsworth {
                     /*
                      * Slide is a nice way to change position
                      */
-                    n.addAnnotation(HINT_GLISS);
+                    f.addAnnotation(HINT_GLISS);
                 }
                 else if (init_fingering.strg > current_fingering.strg) {
-                    n.addAnnotation(ANNO_LAYOVER);
+                    f.addAnnotation(ANNO_LAYOVER);
                     /*
                      * Although this is a layover, don't just add the
                      * layover penalty. You really don't want to use a layover
                      * to change position.
                      */
-                    c.addCost(vn_bad_pos_change_penalty);
-                    c.addCost(20);
+                    cost += weights_.bad_pos_change_penalty;
+                    cost += 20;
                 }
                 else {
-                    n.addAnnotation(ANNO_BADCHANGE);
-                    c.addCost(vn_bad_pos_change_penalty);
-                    c.addCost(20);
+                    f.addAnnotation(ANNO_BADCHANGE);
+                    cost += weights_.bad_pos_change_penalty;
+                    cost += 20;
                 }
             }
             else if (init_fingering.finger > current_fingering.finger) {
@@ -203,8 +111,8 @@ namespace Holdsworth {
                     if (((init_fingering.fret - current_fingering.fret)
                             - (init_fingering.finger - current_fingering.finger))
                         > 3) { // TODO magic number
-                        n.addAnnotation(ANNO_BADSTRETCH);
-                        c.addCost(vn_bad_pos_change_penalty);
+                        f.addAnnotation(ANNO_BADSTRETCH);
+                        cost += weights_.bad_pos_change_penalty;
                     }
                     else if (
                         (((init_fingering.fret - current_fingering.fret)
@@ -212,18 +120,18 @@ namespace Holdsworth {
                         > 2) // TODO magic number
                         && init_fingering.finger == LittleFinger
                         ) {
-                        n.addAnnotation(ANNO_BADSTRETCH);
-                        c.addCost(vn_bad_pos_change_penalty);
+                        f.addAnnotation(ANNO_BADSTRETCH);
+                        cost += weights_.bad_pos_change_penalty;
                     }
                 }
                 else if (init_fingering.strg == current_fingering.strg) {
                     init_fingering.finger = current_fingering.finger;
-                    n.setFingering(init_fingering);
-                    n.addAnnotation(HINT_GLISS);
+                    f = init_fingering;
+                    f.addAnnotation(HINT_GLISS);
                 }
                 else {
-                    n.addAnnotation(ANNO_BADCHANGE);
-                    c.addCost(vn_bad_pos_change_penalty);
+                    f.addAnnotation(ANNO_BADCHANGE);
+                    cost += weights_.bad_pos_change_penalty;
                 }
             }
             else /* init_fingering.finger < current_fingering.finger */ {
@@ -241,32 +149,261 @@ namespace Holdsworth {
                 }
                 else if (init_fingering.strg == current_fingering.strg) {
                     init_fingering.finger = current_fingering.finger;
-                    n.setFingering(init_fingering);
-                    n.addAnnotation(HINT_GLISS);
+                    f = init_fingering;
+                    f.addAnnotation(HINT_GLISS);
                 }
                 else {
-                    n.addAnnotation(ANNO_BADCHANGE);
-                    c.addCost(vn_bad_pos_change_penalty);
+                    f.addAnnotation(ANNO_BADCHANGE);
+                    cost += weights_.bad_pos_change_penalty;
                 }
             }
         }
 
-        c.addNote(n);
+        return true;
+    }
+
+    /*!
+     * Fingering of a note within a chunk, i.e. without a change of position.
+     */
+    template <class Hand>
+    bool VNAlgorithmT<Hand>::nextFingering(const FingerPosition &start_p,
+                                        const Fingering& current_fingering,
+                                        const Fingering& cf,
+                                        Fingering& this_fingering,
+                                        int& cost)
+    {
+        /*
+         * We are only interested if we can avoid shifting position.
+         */
+        if (!Hand::inReach(this_fingering.fret, start_p)) {
+            return false;
+        }
+
+        /*
+         * Work out finger. Has it been mandated?
+         */
+        if ((this_fingering.fret == current_fingering.fret) 
+            && (this_fingering.strg == current_fingering.strg)
+        ) {
+            /*
+             * For repeated notes, maintain the current finger
+             * even if it's a "wrong" one (Q-shift)
+             */
+            this_fingering.finger = current_fingering.finger;
+        }
+        else {
+            this_fingering.finger = Hand::getFinger(this_fingering.fret, start_p);
+        }
+        if (cf.finger != NoFingerDefined && cf.finger != this_fingering.finger) {
+            TRACE(TraceDebug) << "Auto-fingering overridden by input hint" << std::endl;
+            return false;
+        }
+
+        int this_cost = 0;
+        /*
+         * This is where we assign costs based on finger/string moves.
+         */
+        if ((this_fingering.finger == current_fingering.finger) 
+                && (this_fingering.strg < current_fingering.strg)
+                && (!Hand::isStretch(this_fingering.fret, start_p))) {
+            this_fingering.addAnnotation(ANNO_QSHIFT);
+            /*
+             * Try a substitution
+             */
+            switch (this_fingering.finger) {
+            case FirstFinger:
+                this_fingering.finger = MiddleFinger;
+                break;
+                
+            case MiddleFinger:
+                this_fingering.finger = RingFinger;
+                break;
+                
+            case RingFinger:
+                this_fingering.finger = LittleFinger;
+                break;
+                
+            case LittleFinger:
+                this_fingering.finger = RingFinger;
+                break;
+
+            default:
+                /*
+                 * Hmm, shouldn't worry about open strings really.
+                 * Or at least, treat them as a special case.
+                 */
+                break;
+                
+            }
+            this_cost += weights_.q_shift_penalty;
+        }
+
+
+        this_cost += Hand::cost(this_fingering, start_p, weights_);
+        if (Hand::isStretch(this_fingering.fret, start_p)) {
+            this_fingering.addAnnotation(ANNO_STRETCH);
+        }
+
+        if (this_fingering.strg != current_fingering.strg) {
+            this_cost += weights_.string_change;
+
+            if (this_fingering.finger == current_fingering.finger) {
+                if (this_fingering.strg < current_fingering.strg) {
+                    /*
+                     * Same finger, lower string (T-move)
+                     */
+                    this_fingering.addAnnotation(ANNO_TMOVE);
+                    this_cost += weights_.t_move_penalty;
+                }
+                else if (this_fingering.fret == current_fingering.fret) {
+                    /*
+                     * Same finger/fret, higher string (layover)
+                     */
+                    this_fingering.addAnnotation(ANNO_LAYOVER);
+                    this_cost += weights_.layover_penalty;
+                }
+                else /*(this_string > current_string)*/ {
+                    /*
+                     * Same finger, higher string (O-move)
+                     */
+                    this_fingering.addAnnotation(ANNO_OMOVE);
+                    this_cost += weights_.o_move_penalty;
+                }
+            }
+        }
+        else if (this_fingering.finger == current_fingering.finger) {
+            if (this_fingering.fret != current_fingering.fret) {
+                /*
+                 * Same finger/string, different fret (A-move)
+                 */
+                this_fingering.addAnnotation(ANNO_AMOVE);
+                this_cost += weights_.a_move_penalty;
+            }
+        }
+
+        /*
+         * Is the price too high?
+         */
+        if (this_cost > weights_.position_break_threshold) {
+            TRACE(TraceDebug) << "Next note possible but at cost " << this_cost << std::endl;
+            return false;
+        }
+
+        cost = this_cost + weights_.note_bonus;
+        return true;
+    }
+
+    /*!
+     * Chunk generation
+     */
+    template <class Hand>
+    Chunk VNAlgorithmT<Hand>::generateChunk(ConstNoteIterator cni,
+                                        const FingerPosition &start_p,
+                                        const FretPos &start_fp,
+                                        const Fingering& force_first,
+                                        const Note *lead_in)
+    {
+        Chunk c;
+        c.setPosition(start_p);
+        c.setStart(cni);
+        c.addCost(walkChunk(cni, start_p, start_fp, force_first, lead_in, 0, 0, &c).cost);
+        return c;
+    }
+
+    template <class Hand>
+    ChunkScore VNAlgorithmT<Hand>::scoreChunk(ConstNoteIterator cni,
+                                        const FingerPosition &start_p,
+                                        const FretPos &start_fp,
+                                        const Fingering& force_first,
+                                        const Note *lead_in,
+                                        int bound,
+                                        const unsigned int *notes_left)
+    {
+        return walkChunk(cni, start_p, start_fp, force_first, lead_in, bound, notes_left, 0);
+    }
+
+    /*!
+     * Walk along the notes for as long as the position holds, adding up
+     * the cost, and the fingerings too if there is a chunk to put them in.
+     * 
+     * \todo Parts of this could (and should) be refactored into the superclass
+     */
+    template <class Hand>
+    ChunkScore VNAlgorithmT<Hand>::walkChunk(ConstNoteIterator cni,
+                                        const FingerPosition &start_p,
+                                        const FretPos &start_fp,
+                                        const Fingering& force_first,
+                                        const Note *lead_in,
+                                        int bound,
+                                        const unsigned int *notes_left,
+                                        Chunk *c)
+    {
+        if (tracing(TraceDebug)) {
+            std::cerr << "VNAlgorithmT::walkChunk" << std::endl;
+            std::cerr << "Starting Note = " << (*cni).dbgDump() << std::endl;
+            std::cerr << "Starting LH Position: " << start_p << std::endl;
+            std::cerr << "Starting Fretboard Position: string=" << start_fp.strg << " fret=" << start_fp.fret << std::endl;
+            if (lead_in != 0) {
+                std::cerr << "Lead-in note = " << lead_in->dbgDump() << std::endl;
+            }
+        }
+        ChunkScore score;
+
+        /*
+         * Finger the first note
+         */
+        Fingering init_fingering;
+        init_fingering.addAnnotation((*cni).annotation());
+        init_fingering.fret = start_fp.fret;
+        init_fingering.strg = start_fp.strg;
+
+        Fingering lead_in_fingering;
+        if (lead_in != 0) {
+            lead_in_fingering = lead_in->fingering();
+        }
+
+        /*
+         * The calls to startFingering() and nextFingering() are qualified,
+         * so that they (and the Hand lookups within) can be inlined.
+         */
+        int start_cost = 0;
+        if (!VNAlgorithmT::startFingering(start_p, (lead_in != 0) ? &lead_in_fingering : 0, force_first, init_fingering, start_cost)) {
+            score.cost = 100000; /* Make sure this chunk isn't chosen!! */
+            return score;
+        }
+
+        score.cost += start_cost;
+        score.length = 1;
+        score.last = init_fingering;
+        if (c != 0) {
+            c->addFingering(init_fingering);
+        }
 
         /*
          * Now to start iterating through the note list, and see how far we get.
          */
-        current_fingering = n.fingering();
+        Fingering current_fingering = init_fingering;
         
         ++cni;
         while ((*cni).noteNum() != -1) {
 
+            /*
+             * Every note still to come earns at most the note bonus (the
+             * penalties are never negative). If even that can't bring us
+             * under the bound, give up.
+             */
+            if ((notes_left != 0) && (score.cost + qMin(weights_.note_bonus, 0) * (int) notes_left[score.length] > bound)) {
+                TRACE(TraceDebug) << "Abandoned after " << score.length << " notes with score " << score.cost << std::endl;
+                score.pruned = true;
+                return score;
+            }
+
             if ((*cni).noteNum() == 0) {
                 /* Rest */
-                Note n;
-                n.setDuration((*cni).duration());
-
-                c.addNote(n);
+                ++score.length;
+                if (c != 0) {
+                    c->addFingering(Fingering());
+                }
 
                 /*
                  * ...and onto the next note
@@ -278,13 +415,11 @@ namespace Holdsworth {
             Fingering cf = (*cni).fingering();
             
             if ((*cni).hasBreakHint()) {
-#ifdef EXTRA_DEBUG
-                qDebug("Position break hint after %d notes with score %d", c.length(), c.cost());
-#endif
+                TRACE(TraceDebug) << "Position break hint after " << score.length << " notes with score " << score.cost << std::endl;
                 /*
                  * Return what we have so far
                  */
-                return c;
+                return score;
             }
 
             if ((*cni).hasGlissHint()) {
@@ -301,7 +436,7 @@ namespace Holdsworth {
             /*
              * For each possible place on the fretboard...
              */
-            FretPosList fpcandidates = instrument_->candidates(*cni);
+            const FretPosList& fpcandidates = instrument_->candidates(*cni);
             for (FretPosList::const_iterator fp = fpcandidates.begin();
                     fp != fpcandidates.end();
                     ++fp)
@@ -310,141 +445,25 @@ namespace Holdsworth {
                  * Has the string been mandated?
                  */
                 if ((cf.strg != NotDefined) && (cf.strg != (*fp).strg)) {
-#ifdef EXTRA_DEBUG
-                    qDebug("Auto-string overridden by input hint");
-#endif
+                    TRACE(TraceDebug) << "Auto-string overridden by input hint" << std::endl;
                     continue;
                 }
-                
+
+                Fingering this_fingering;
+                this_fingering.fret = (*fp).fret;
+                this_fingering.strg = (*fp).strg;
+
+                int this_cost = 0;
+                if (!VNAlgorithmT::nextFingering(start_p, current_fingering, cf, this_fingering, this_cost)) {
+                    continue;
+                }
+
                 /*
-                 * For each possible LH position....
+                 * Do we have a new best one?
                  */
-                FingerPositionList pcandidates = candidates(*fp);
-                for (FingerPositionList::const_iterator p = pcandidates.begin();
-                        p != pcandidates.end();
-                        ++p)
-                {
-                    /*
-                     * We are only interested if we can avoid shifting position.
-                     */
-                    if ((*p) == start_p) {
-                        Fingering this_fingering;
-                        this_fingering.fret = (*fp).fret;
-                        this_fingering.strg = (*fp).strg;
-
-                        /*
-                         * Work out finger. Has it been mandated?
-                         */
-                        if ((this_fingering.fret == current_fingering.fret) 
-                            && (this_fingering.strg == current_fingering.strg)
-                        ) {
-                            /*
-                             * For repeated notes, maintain the current finger
-                             * even if it's a "wrong" one (Q-shift)
-                             */
-                            this_fingering.finger = current_fingering.finger;
-                        }
-                        else {
-                            this_fingering.finger = handmodel_->getFinger(this_fingering.fret, start_p);
-                        }
-                        if (cf.finger != NoFingerDefined && cf.finger != this_fingering.finger) {
-#ifdef EXTRA_DEBUG
-                            qDebug("Auto-fingering overridden by input hint");
-#endif
-                            continue;
-                        }
-
-                        int this_cost = 0;
-                        /*
-                         * This is where we assign costs based on finger/string moves.
-                         */
-                        if ((this_fingering.finger == current_fingering.finger) 
-                                && (this_fingering.strg < current_fingering.strg)
-                                && (!handmodel_->isStretch(this_fingering.fret, start_p))) {
-                            this_fingering.addAnnotation(ANNO_QSHIFT);
-                            /*
-                             * Try a substitution
-                             */
-                            switch (this_fingering.finger) {
-                            case FirstFinger:
-                                this_fingering.finger = MiddleFinger;
-                                break;
-                                
-                            case MiddleFinger:
-                                this_fingering.finger = RingFinger;
-                                break;
-                                
-                            case RingFinger:
-                                this_fingering.finger = LittleFinger;
-                                break;
-                                
-                            case LittleFinger:
-                                this_fingering.finger = RingFinger;
-                                break;
-
-                            default:
-                                /*
-                                 * Hmm, shouldn't worry about open strings really.
-                                 * Or at least, treat them as a special case.
-                                 */
-                                break;
-                                
-                            }
-                            this_cost += vn_q_shift_penalty;
-                        }
-
-
-                        this_cost += handmodel_->cost(this_fingering, start_p);
-                        if (handmodel_->isStretch(this_fingering.fret, start_p)) {
-                            this_fingering.addAnnotation(ANNO_STRETCH);
-                        }
-
-                        if (this_fingering.strg != current_fingering.strg) {
-                            this_cost += vn_string_change;
-
-                            if (this_fingering.finger == current_fingering.finger) {
-                                if (this_fingering.strg < current_fingering.strg) {
-                                    /*
-                                     * Same finger, lower string (T-move)
-                                     */
-                                    this_fingering.addAnnotation(ANNO_TMOVE);
-                                    this_cost += vn_t_move_penalty;
-                                }
-                                else if (this_fingering.fret == current_fingering.fret) {
-                                    /*
-                                     * Same finger/fret, higher string (layover)
-                                     */
-                                    this_fingering.addAnnotation(ANNO_LAYOVER);
-                                    this_cost += vn_layover_penalty;
-                                }
-                                else /*(this_string > current_string)*/ {
-                                    /*
-                                     * Same finger, higher string (O-move)
-                                     */
-                                    this_fingering.addAnnotation(ANNO_OMOVE);
-                                    this_cost += vn_o_move_penalty;
-                                }
-                            }
-                        }
-                        else if (this_fingering.finger == current_fingering.finger) {
-                            if (this_fingering.fret != current_fingering.fret) {
-                                /*
-                                 * Same finger/string, different fret (A-move)
-                                 */
-                                this_fingering.addAnnotation(ANNO_AMOVE);
-                                this_cost += vn_a_move_penalty;
-                            }
-                        }
-                        
-                        
-                        /*
-                         * Do we have a new best one?
-                         */
-                        if (this_cost < lowest_cost) {
-                            lowest_cost = this_cost;
-                            fingeringtry = this_fingering;
-                        }
-                    }
+                if (this_cost < lowest_cost) {
+                    lowest_cost = this_cost;
+                    fingeringtry = this_fingering;
                 }
             }
 
@@ -452,38 +471,24 @@ namespace Holdsworth {
              * Is the price too high?
              */
             if (fingeringtry.fret == NotDefined) {
-#ifdef SOME_DEBUG
-                qDebug("Have to break position, after %d notes with score %d", c.length(), c.cost());
-#endif
-                /*
-                 * Return what we have so far
-                 */
-                return c;
-            }
-            else if (lowest_cost > vn_position_break_threshold) {
-#ifdef SOME_DEBUG
-                qDebug("Next note possible but at cost %d", lowest_cost);
-                qDebug("Have to break position, after %d notes with score %d", c.length(), c.cost());
-#endif
+                TRACE(TraceDebug) << "Have to break position, after " << score.length << " notes with score " << score.cost << std::endl;
                 /*
                  * Return what we have so far
                  */
-                return c;
+                return score;
             }
-            else /* if (fingeringtry.fret != NotDefined)*/ {
-                Note n((*cni).noteNum());
-                n.setDuration((*cni).duration());
-                n.setFingering(fingeringtry);
+            else {
                 current_fingering = fingeringtry;
                 
-#ifdef EXTRA_DEBUG
-                qDebug(">>> %s", n.dbgDump().c_str());
-                qDebug("c += %d", lowest_cost);
-#endif
-
-                c.addNote(n);
-                c.addCost(lowest_cost);
-                c.addCost(vn_note_bonus);
+                TRACE(TraceDebug) << ">>> string: " << fingeringtry.strg << " fret: " << fingeringtry.fret
+                    << " finger: " << fingeringtry.finger << " c += " << lowest_cost << std::endl;
+
+                score.cost += lowest_cost;
+                ++score.length;
+                score.last = fingeringtry;
+                if (c != 0) {
+                    c->addFingering(fingeringtry);
+                }
             }
 
             /*
@@ -495,10 +500,14 @@ namespace Holdsworth {
         /*
          * Complete success - we have reached the end of the notelist.
          */
-#ifdef SOME_DEBUG
-        qDebug("Got to the end of the note list with score=%d", c.cost());
-        dbgDumpNoteList(c.noteList());
-#endif        
-        return c;
+        TRACE(TraceDebug) << "Got to the end of the note list with score=" << score.cost << std::endl;
+        return score;
     }
+
+    /*
+     * The hands we know about.
+     */
+    template class VNAlgorithmT<StandardHand>;
+    template class VNAlgorithmT<ExtendedHand>;
+    template class VNAlgorithmT<DoubleExtendedHand>;
 }
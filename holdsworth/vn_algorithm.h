@@ -24,19 +24,32 @@
 
 
 #include <holdsworth/algorithm.h>
+#include <holdsworth/handmodel.h>
+#include <holdsworth/handmodelx.h>
+#include <holdsworth/handmodelx2.h>
 
 namespace Holdsworth {
 
 /*!
  * \brief Implementation of VN's algorithm that plots out feasible fingerings.
  *
+ * The algorithm is specialised at compile time on the hand (see HandPolicy),
+ * so that the finger, stretch and cost lookups in the inner loop can be
+ * inlined. The matching run-time HandModel is installed by the constructor,
+ * for the benefit of the Engine.
+ *
+ * Instantiations exist for StandardHand, ExtendedHand and DoubleExtendedHand.
  */
-class VNAlgorithm : public Algorithm
+template <class Hand>
+class VNAlgorithmT : public Algorithm
 {
 public:
-    VNAlgorithm()
+    VNAlgorithmT()
 	: Algorithm()
-	{}
+	, model_()
+	{
+	    setHandModel(&model_);
+	}
 
     /*!
      * \brief Build a block of fingering.
@@ -46,10 +59,21 @@ public:
      */
     virtual Chunk generateChunk(ConstNoteIterator, const FingerPosition&, const FretPos&, const Fingering& force_first, const Note *lead_in);
 
+    virtual ChunkScore scoreChunk(ConstNoteIterator, const FingerPosition&, const FretPos&, const Fingering& force_first, const Note *lead_in, int bound, const unsigned int *notes_left);
+
+    virtual bool startFingering(const FingerPosition&, const Fingering *lead_in, const Fingering& force_first, Fingering&, int& cost);
+    virtual bool nextFingering(const FingerPosition&, const Fingering& current, const Fingering& mandated, Fingering&, int& cost);
+
 
 private:
+    ChunkScore walkChunk(ConstNoteIterator, const FingerPosition&, const FretPos&, const Fingering& force_first, const Note *lead_in, int bound, const unsigned int *notes_left, Chunk *);
 
+    typename Hand::ModelType model_;
 };
 
+typedef VNAlgorithmT<StandardHand> VNAlgorithm;                 /*!< \brief VN's algorithm, standard hand */
+typedef VNAlgorithmT<ExtendedHand> VNAlgorithmX;                /*!< \brief VN's algorithm, first finger extensions */
+typedef VNAlgorithmT<DoubleExtendedHand> VNAlgorithmX2;         /*!< \brief VN's algorithm, double extensions */
+
 }
 #endif /* HOLDSWORTH_VN_ALGORITHM_H */
@@ -0,0 +1,86 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: Writing fingered notes as LilyPond.
+ */
+
+#include <holdsworth/debugging.h>
+#include "lilypond.h"
+
+namespace {
+
+    /*
+     * LilyPond names can't have digits in them, so the parts of a score are
+     * called A, B, ... Z, BA, BB, ...
+     */
+    QString partName(unsigned int i)
+    {
+        QString name;
+        do {
+            name = QString(QChar('A' + (i % 26))) + name;
+            i /= 26;
+        } while (i > 0);
+        return name;
+    }
+}
+
+void writeLilypondHeader(QTextStream& os, bool eps, const QString& title, const QString& cmdline)
+{
+    os << "\\include \"english.ly\"" << endl;
+    if (eps) {
+        os << "\\paper{" << endl;
+        os << "    indent=0\\mm" << endl;
+        os << "    line-width=180\\mm" << endl;
+        os << "    oddFooterMarkup=##f" << endl;
+        os << "    oddHeaderMarkup=##f" << endl;
+        os << "    bookTitleMarkup = ##f" << endl;
+        os << "    scoreTitleMarkup = ##f" << endl;
+        os << "}" << endl;
+    }
+    else {
+        os << "\\header{" << endl;
+        os << "  title = \"" << title << "\"" << endl;
+        os << "  tagline = \\markup \\center-column {\"Tab generated by the Holdsworth library\" \"Command Line: fing " << cmdline << "\"}" << endl;
+        os <<    "}" << endl;
+    }
+}
+
+void writeLilypondLine(QTextStream& os, const Holdsworth::NoteList& output, const Holdsworth::FretDiagramMap *diagrams,
+        int key_sig, bool use_flats, bool show_annotations)
+{
+    os << "frag = {" << endl;
+    Holdsworth::dbgLilypondDumpNoteList(output, os, true, use_flats, show_annotations, diagrams);
+    os << "}" << endl;
+    os << "fragt = {" << endl;
+    Holdsworth::dbgLilypondDumpNoteList(output, os, false, false, false);
+    os << "}" << endl;
+    os << "\\new StaffGroup << \\new Staff { \\clef \"G_8\" "
+        << Holdsworth::dbgLilypondKeySig(key_sig)
+        << "  \\frag } \\new TabStaff { \\fragt } >> " << endl;
+}
+
+void writeLilypondScore(QTextStream& os, const Holdsworth::Score& score, int key_sig, bool use_flats, bool show_annotations)
+{
+    for (unsigned int i = 0; i < score.size(); ++i) {
+        QString name = partName(i);
+        os << "frag" << name << " = {" << endl;
+        Holdsworth::dbgLilypondDumpNoteList(score[i].output, os, true, use_flats, show_annotations, &score[i].diagrams);
+        os << "}" << endl;
+        os << "fragt" << name << " = {" << endl;
+        Holdsworth::dbgLilypondDumpNoteList(score[i].output, os, false, false, false);
+        os << "}" << endl;
+    }
+
+    os << "<<" << endl;
+    for (unsigned int i = 0; i < score.size(); ++i) {
+        QString name = partName(i);
+        QString label = QString::fromStdString(score[i].id);
+        if (score[i].voice != 1) {
+            label += "/" + QString::number(score[i].voice);
+        }
+        os << "  \\new StaffGroup \\with { instrumentName = \"" << label << "\" } "
+            << "<< \\new Staff { \\clef \"G_8\" "
+            << Holdsworth::dbgLilypondKeySig(key_sig)
+            << "  \\frag" << name << " } \\new TabStaff { \\fragt" << name << " } >>" << endl;
+    }
+    os << ">>" << endl;
+}
@@ -0,0 +1,34 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: Writing fingered notes as LilyPond.
+ */
+
+#ifndef FING_LILYPOND_H
+#define FING_LILYPOND_H
+
+#include <QString>
+#include <QTextStream>
+#include <holdsworth/note.h>
+#include <holdsworth/score.h>
+
+/*!
+ * \brief Write the start of a LilyPond file: the paper settings for an EPS
+ * file, or else a header with the title and the command line.
+ */
+void writeLilypondHeader(QTextStream& os, bool eps, const QString& title, const QString& cmdline);
+
+/*!
+ * \brief Write one line of fingered notes, as a staff and a tab staff.
+ *
+ * \param diagrams Fret diagrams to go with the notes, if any
+ */
+void writeLilypondLine(QTextStream& os, const Holdsworth::NoteList& output, const Holdsworth::FretDiagramMap *diagrams,
+        int key_sig, bool use_flats, bool show_annotations);
+
+/*!
+ * \brief Write each part of a fingered score as a StaffGroup of its own,
+ * with the parts played together.
+ */
+void writeLilypondScore(QTextStream& os, const Holdsworth::Score& score, int key_sig, bool use_flats, bool show_annotations);
+
+#endif
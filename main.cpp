@@ -4,8 +4,10 @@
  */
 
 #include <iostream>
+#include <fstream>
 #include <QFile>
 #include <QDateTime>
+#include <QScopedPointer>
 #include <QDebug>
 #include <holdsworth/types.h>
 #include <holdsworth/instrumentdefn.h>
@@ -15,11 +17,57 @@
 #include <holdsworth/vn_algorithm.h>
 #include <holdsworth/debugging.h>
 #include <holdsworth/musicxmlloader.h>
+#include <holdsworth/notecache.h>
+#include <holdsworth/resultcache.h>
+#include <holdsworth/score.h>
+#include <holdsworth/textloader.h>
+#include <holdsworth/trace.h>
+#include "sweep.h"
+#include "server.h"
+#include "lilypond.h"
+#include "migt.h"
 #include "mygetopt.h"
 #include "version.i"
 
 
-bool quiet = false;
+/*
+ * Write the statistics for a run as a single line of JSON, so that batch
+ * jobs can collect them.
+ */
+static void
+write_statistics_json(std::ostream& os, const QString& input, unsigned int notes, int ms,
+        const Holdsworth::EngineStatistics& es)
+{
+    os << "{\"input\": \"";
+    QByteArray name = input.toUtf8();
+    for (const char *c = name.constData(); *c != 0; ++c) {
+        if ((*c == '"') || (*c == '\\')) {
+            os << '\\' << *c;
+        }
+        else if ((unsigned char) *c < 0x20) {
+            os << ' ';
+        }
+        else {
+            os << *c;
+        }
+    }
+    os << "\", \"notes\": " << notes
+        << ", \"ms\": " << ms
+        << ", \"segments\": " << es.segments
+        << ", \"passes\": " << es.passes
+        << ", \"chunk_candidates\": " << es.chunk_candidates
+        << ", \"chunk_cache_hits\": " << es.chunk_cache_hits
+        << ", \"chunk_cache_misses\": " << es.chunk_cache_misses
+        << ", \"chunks_pruned\": " << es.chunks_pruned
+        << ", \"chunks_generated\": " << es.chunks_generated
+        << ", \"hints_inserted\": " << es.hints_inserted
+        << ", \"hints_purged\": " << es.hints_purged
+        << ", \"search_states\": " << es.search_states
+        << ", \"result_cache_hits\": " << es.result_cache_hits
+        << ", \"cost\": " << es.cost
+        << ", \"shifts\": " << es.shifts
+        << "}" << std::endl;
+}
 
 static void
 show_usage()
@@ -35,9 +83,13 @@ show_usage()
     std::cout << "--input=FILE        Take input notes from FILE (default: inputnotes)" << std::endl;
     std::cout << "  --dumbtab         Interpret input notes as being in dumbtab format" << std::endl;
     std::cout << "  --midicsv         Interpret input notes as being in midicsv format" << std::endl;
-    std::cout << "  --musicxml        Interpret input notes as being in musicXML format" << std::endl;
+    std::cout << "  --musicxml        Interpret input notes as being in musicXML format (plain or compressed .mxl)" << std::endl;
     std::cout << "    --note-offset=N Shift MusicXML notes by N semitones. Used if input file as notes as sounded, not as written." << std::endl;
-    std::cout << "    --force           Force use of note allocations in MusicXML input" << std::endl << std::endl;
+    std::cout << "                    Each part (and voice) of a MusicXML score is fingered separately; --threads=N" << std::endl
+        << "                    fingers N at once." << std::endl;
+    std::cout << "    --force           Force use of note allocations in MusicXML input" << std::endl;
+    std::cout << "--note-cache=DIR    Keep the notes read from each input file in DIR, and read them" << std::endl
+        << "                    from there instead when the same file is fingered again" << std::endl << std::endl;
     std::cout << "Output Options:" << std::endl;
     std::cout << "--output=FILE       Output to FILE (default: input filename + .ly, or fingout for selftests)" << std::endl;
     std::cout << "  --eps             Generate lilypond suitable for generating an EPS file" << std::endl;
@@ -48,10 +100,36 @@ show_usage()
     std::cout << "--extended2         Use double extended fingering" << std::endl;
     //std::cout << "--no-back-to-back   Inhibit back-to-back gliss shifts" << std::endl;
     std::cout << "--back-to-back      Allow back-to-back gliss shifts" << std::endl;
-    std::cout << "--maxshift=N        Try to keep shifts to <=N frets" << std::endl << std::endl;
+    std::cout << "--maxshift=N        Try to keep shifts to <=N frets" << std::endl;
+    std::cout << "--global            Use a single-pass global search instead of auto-hinted chunks" << std::endl;
+    std::cout << "--segments          Finger the parts between restart hints independently, in parallel" << std::endl;
+    std::cout << "--lookahead=N       Finger the notes one at a time, as for live input, finalising" << std::endl;
+    std::cout << "                    each one N notes later" << std::endl;
+    std::cout << "--result-cache[=DIR]" << std::endl
+        << "                    Re-use the fingering of any part already fingered with the same settings," << std::endl
+        << "                    remembering them in DIR (default: only for this run)" << std::endl;
+    std::cout << "  --result-cache-size=MB" << std::endl
+        << "                    Keep at most MB megabytes of results in memory, and in DIR (default: 64)" << std::endl << std::endl;
+    std::cout << "Tuning Options:" << std::endl;
+    std::cout << "--sweep=DIR         Finger every file in DIR with each set of cost weights, and" << std::endl;
+    std::cout << "                    report the total cost, shifts and speed of each. The input" << std::endl;
+    std::cout << "                    format and algorithm control options apply to every file," << std::endl;
+    std::cout << "                    and --threads=N fingers N files at once." << std::endl;
+    std::cout << "  --weights=FILE    Sets of cost weights to try, one per line, as name=value pairs" << std::endl
+        << "                    (only note_bonus and position_break_threshold may be negative)" << std::endl << std::endl;
+    std::cout << "Server Options:" << std::endl;
+    std::cout << "--server[=SOCKET]   Keep running, fingering jobs read one per line as JSON from stdin" << std::endl
+        << "                    (or from each client of the Unix domain socket SOCKET), and writing" << std::endl
+        << "                    each result back as a line of JSON when it is ready. The other options" << std::endl
+        << "                    are the defaults for every job, and --threads=N fingers N jobs at once." << std::endl << std::endl;
     std::cout << "Misc Options:" << std::endl;
+    std::cout << "--threads=N         Use N threads to generate candidate chunks" << std::endl;
     std::cout << "--quiet             Don't print cryptic progress stuff" << std::endl;
+    std::cout << "--trace=N           How much to say: 0 nothing, 1 progress (default), 2 chunk" << std::endl
+        << "                    decisions, 3 note-by-note workings (if compiled in)" << std::endl;
     std::cout << "--statistics        Print end-of-run statistics" << std::endl;
+    std::cout << "--statistics-json[=FILE]" << std::endl
+        << "                    Append end-of-run statistics to FILE (default: stdout) as a line of JSON" << std::endl;
     std::cout << "--help              This message" << std::endl;
     //std::cout << "--test=TESTNAME     Run internal test [scale|sheets|unmerry]" << std::endl;
 }
@@ -61,6 +139,7 @@ int main(int argc, char ** argv)
     GetOpt opts(argc, argv);
 
     bool usage = false;
+    bool quiet = false;
     bool extended = false;
     bool extended2 = false;
     bool stats = false;
@@ -73,6 +152,8 @@ int main(int argc, char ** argv)
     bool force = false;
     bool use_flats = false;
     bool no_annotations = false;
+    bool global = false;
+    bool segments = false;
     uint max_num_passes = 50;
     int key_sig = 0;
     int note_offset = 0;
@@ -82,6 +163,16 @@ int main(int argc, char ** argv)
     QString testname;
     QString maxshift;
     QString max_num_passes_str;
+    QString threads_str;
+    QString lookahead_str;
+    QString sweep_dir;
+    QString weights_file;
+    QString json_file;
+    QString trace_str;
+    QString note_cache_dir;
+    QString result_cache_dir;
+    QString result_cache_size_str;
+    QString server_str;
 
     uint migt_scale;
     uint migt_step;
@@ -107,10 +198,19 @@ int main(int argc, char ** argv)
     opts.addSwitch("eps", &eps);
     opts.addSwitch("use-flats", &use_flats);
     opts.addSwitch("no-annotations", &no_annotations);
+    opts.addSwitch("global", &global);
+    opts.addSwitch("segments", &segments);
     opts.addOption('t', "hint", &hinttxt);
     opts.addOption('m', "maxshift", &maxshift);
     opts.addOption('p', "max-passes", &max_num_passes_str);
     opts.addOption('O', "note-offset", &note_offset_str);
+    opts.addOption('j', "threads", &threads_str);
+    opts.addOption('l', "lookahead", &lookahead_str);
+    opts.addOption('S', "sweep", &sweep_dir);
+    opts.addOption('w', "weights", &weights_file);
+    opts.addOption('T', "trace", &trace_str);
+    opts.addOption('C', "note-cache", &note_cache_dir);
+    opts.addOption('R', "result-cache-size", &result_cache_size_str);
     opts.addOptionalOption("output", &outfilename, "fingout");
     opts.addOptionalOption("input", &infilename, "inputnotes");
     opts.addOptionalOption("test", &testname, "unmerry");
@@ -118,6 +218,9 @@ int main(int argc, char ** argv)
     opts.addOptionalOption("migt-step", &migt_step_str, "1");
     opts.addOptionalOption("migt-start", &migt_start_str, "45");
     opts.addOptionalOption("migt-range", &migt_range_str, "2");
+    opts.addOptionalOption("statistics-json", &json_file, "-");
+    opts.addOptionalOption("result-cache", &result_cache_dir, "-");
+    opts.addOptionalOption("server", &server_str, "-");
 
     if (!opts.parse()) {
         show_usage();
@@ -129,6 +232,13 @@ int main(int argc, char ** argv)
         return 0;
     }
 
+    if (quiet) {
+        Holdsworth::setTraceLevel(Holdsworth::TraceNone);
+    }
+    if (!trace_str.isEmpty()) {
+        Holdsworth::setTraceLevel(trace_str.toInt());
+    }
+
     if (!infilename.isEmpty() && outfilename.isEmpty()) {
         outfilename = infilename + ".ly";
     }
@@ -142,19 +252,86 @@ int main(int argc, char ** argv)
     }
 
     Holdsworth::InstrumentDefn t_defn;
-    Holdsworth::HandModel *t_model;
+
+    Holdsworth::ResultCache result_cache;
+    if (!result_cache_dir.isEmpty()) {
+        qint64 limit = Holdsworth::ResultCache::dflt_max_memory;
+        if (!result_cache_size_str.isEmpty()) {
+            limit = result_cache_size_str.toLongLong() * 1024 * 1024;
+        }
+        result_cache.setMaxMemory(limit);
+        if (result_cache_dir != "-") {
+            result_cache.setDirectory(result_cache_dir, limit);
+        }
+    }
+
+    if (!sweep_dir.isEmpty()) {
+        SweepOptions sweep_opts;
+        sweep_opts.hand = extended2 ? 2 : (extended ? 1 : 0);
+        sweep_opts.back_to_back = allow_back_to_back_gliss;
+        sweep_opts.global = global;
+        sweep_opts.max_lh_shift = maxshift.toInt();
+        sweep_opts.max_passes = max_num_passes;
+        sweep_opts.threads = threads_str.toInt();
+        sweep_opts.musicxml = musicxml;
+        sweep_opts.format = midicsv ? Holdsworth::MidiCsv : (dumbtab ? Holdsworth::DumbTab : Holdsworth::TextNotes);
+        sweep_opts.force = force;
+        sweep_opts.note_offset = note_offset;
+
+        std::vector<SweepConfig> configs;
+        if (!weights_file.isEmpty() && !readSweepConfigs(weights_file, configs)) {
+            return 1;
+        }
+        if (configs.empty()) {
+            configs.push_back(SweepConfig());
+            configs.back().name = "defaults";
+        }
+
+        Holdsworth::setTraceLevel(Holdsworth::TraceNone);
+        std::vector<SweepInput> inputs;
+        if (!loadSweepInputs(sweep_dir, t_defn, sweep_opts, inputs)) {
+            return 1;
+        }
+        runSweep(configs, inputs, t_defn, sweep_opts);
+        return 0;
+    }
+
+    if (!server_str.isEmpty()) {
+        ServerOptions server_opts;
+        server_opts.hand = extended2 ? 2 : (extended ? 1 : 0);
+        server_opts.back_to_back = allow_back_to_back_gliss;
+        server_opts.global = global;
+        server_opts.segments = segments;
+        server_opts.max_lh_shift = maxshift.toInt();
+        server_opts.max_passes = max_num_passes;
+        server_opts.threads = threads_str.toInt();
+        server_opts.musicxml = musicxml;
+        server_opts.format = midicsv ? Holdsworth::MidiCsv : (dumbtab ? Holdsworth::DumbTab : Holdsworth::TextNotes);
+        server_opts.force = force;
+        server_opts.note_offset = note_offset;
+        server_opts.use_flats = use_flats;
+        server_opts.annotations = !no_annotations;
+        server_opts.eps = eps;
+        server_opts.note_cache_dir = note_cache_dir;
+        if (!result_cache_dir.isEmpty()) {
+            server_opts.result_cache = &result_cache;
+        }
+
+        /* stdout is for the results */
+        Holdsworth::setTraceLevel(Holdsworth::TraceNone);
+        return runServer((server_str == "-") ? QString() : server_str, t_defn, server_opts);
+    }
+
+    QScopedPointer<Holdsworth::Algorithm> t_alg;
     if (extended2) {
-	t_model = new Holdsworth::HandModelX2;
+        t_alg.reset(new Holdsworth::VNAlgorithmX2);
     }
     else if (extended) {
-        t_model = new Holdsworth::HandModelX;
+        t_alg.reset(new Holdsworth::VNAlgorithmX);
     }
     else {
-        t_model = new Holdsworth::HandModel;
+        t_alg.reset(new Holdsworth::VNAlgorithm);
     }
-
-    Holdsworth::VNAlgorithm t_alg;
-    t_alg.setHandModel(t_model);
     
     Holdsworth::Constraints t_constraints;
     t_constraints.setBTBGliss(allow_back_to_back_gliss);
@@ -163,14 +340,26 @@ int main(int argc, char ** argv)
     if (!maxshift.isEmpty()) {
         t_engine.setMaxLHShift(maxshift.toInt());
     }
+    if (global) {
+        t_engine.setSearchMode(Holdsworth::Engine::GlobalSearch);
+    }
+    t_engine.setSplitAtRestarts(segments);
+    if (!threads_str.isEmpty()) {
+        t_engine.setThreads(threads_str.toInt());
+    }
     
     t_engine.setInstrument(&t_defn);
-    t_engine.setAlgorithm(&t_alg);
+    t_engine.setAlgorithm(t_alg.data());
     t_engine.setConstraints(&t_constraints);
 
+    if (!result_cache_dir.isEmpty()) {
+        t_engine.setResultCache(&result_cache);
+    }
+
 
 
     Holdsworth::NoteList nl;
+    Holdsworth::Score score;
 
     if (!migt_scale_str.isEmpty()) {
 
@@ -199,71 +388,7 @@ int main(int argc, char ** argv)
             migt_range = 24;
         }
 
-
-	bool scale_notes[12];
-
-	std::cout << "MIGT Scale: ";
-	for (uint i = 0; i < 12; ++i) {
-	    scale_notes[i] = ((migt_scale & (1 << i)) != 0);
-	    if (scale_notes[i]) {
-		std::cout << "O";
-	    }
-	    else {
-		std::cout << ".";
-	    }
-	}
-	std::cout << std::endl;
-
-	uint scale_steps[12];
-	uint num_steps = 0;
-
-	scale_steps[num_steps] = 1;
-	for (uint i = 1; i < 12; ++i) {
-	    if (scale_notes[i]) {
-		std::cout << scale_steps[num_steps] << "/";
-		++num_steps;
-		scale_steps[num_steps] = 1;
-	    }
-	    else {
-		++scale_steps[num_steps];
-	    }
-	}
-	std::cout << scale_steps[num_steps] << std::endl;
-	if (migt_step == 0) {
-	    migt_step = num_steps;
-	}
-	++num_steps;
-	std::cout << num_steps << " note scale." << std::endl;
-
-
-        nl.push_front(Holdsworth::Note(migt_start));
-
-        for (uint k = 1; k <= migt_step; ++k) {
-            uint start_note = 0;
-            uint this_note = start_note;
-            uint this_step = 0;
-
-            Holdsworth::NoteList nl1;
-            Holdsworth::NoteList nl2;
-            do {
-                //std::cout << "Add notes: " << this_note;
-                nl1.push_back(Holdsworth::Note(this_note + migt_start));
-                nl2.push_front(Holdsworth::Note(this_note + migt_start));
-                for (uint j = 0; j < k; ++j) {
-                    this_note += scale_steps[this_step];
-                    this_note %= migt_range;
-                    ++this_step;
-                    this_step %= num_steps;
-                }
-            } while (this_note != start_note);
-
-            nl1.pop_front();
-            nl2.pop_front();
-            nl2.push_front(Holdsworth::Note(migt_start + migt_range));
-
-            nl.insert(nl.end(), nl1.begin(), nl1.end());
-            nl.insert(nl.end(), nl2.begin(), nl2.end());
-        }
+        generateMIGT(migt_scale, migt_step, migt_start, migt_range, nl);
 
     }
     else if (infilename.isEmpty()) {
@@ -302,95 +427,43 @@ int main(int argc, char ** argv)
         }
     }
     else if (musicxml) {
-        Holdsworth::loadMusicXML(infilename, nl, force, key_sig, note_offset );
+        Holdsworth::NoteCache cache(note_cache_dir);
+        if (lookahead_str.isEmpty()) {
+            cache.setInput(infilename, QString("musicxml score force=%1 offset=%2").arg(force).arg(note_offset));
+            if (!cache.load(score, key_sig)) {
+                Holdsworth::loadMusicXML(infilename, score, force, key_sig, note_offset);
+                cache.store(score, key_sig);
+            }
+            if (score.size() == 1) {
+                nl.swap(score[0].notes);
+                score.clear();
+            }
+        }
+        else {
+            /* A stream is just one line of notes */
+            cache.setInput(infilename, QString("musicxml stream force=%1 offset=%2").arg(force).arg(note_offset));
+            if (!cache.load(nl, key_sig)) {
+                Holdsworth::loadMusicXML(infilename, nl, force, key_sig, note_offset);
+                cache.store(nl, key_sig);
+            }
+        }
         if (key_sig < 0) {
             use_flats = true;
         }
     }
     else {
-        QFile file(infilename);
-        if ( file.open( QIODevice::ReadOnly) ) {
-            QTextStream stream( &file );
-            QString line;
-            while ( !stream.atEnd() ) {
-		QString whole_line;
-
-                int i;
-                QString note_annotation;
-                QString note_type;
-
-		if (midicsv) {
-		    whole_line = stream.readLine();
-		    QStringList sl = whole_line.split(',');
-		    // For now..
-		    if (sl.count() < 6) {
-			    note_type = "x";
-		    }
-		    else if ((sl[2] == " Note_on_c") && (sl[5] != " 0")) {
-			    note_type = "M";
-			    i = sl[4].toInt();
-		    }
-		    else {
-			    note_type = "x";
-		    }
-		    note_annotation = ".";
-		}
-		else if (dumbtab) {
-		    stream >> note_type;
-		    stream >> i;
-		    stream >> note_annotation;
-		}
-		else {
-		    stream >> note_type;
-		    stream >> i;
-		    stream >> note_annotation;
-		}
-
-                stream.skipWhiteSpace();
-		if (note_type == "x") {
-			;
-		}
-		else if (note_type == "M") {
-		    qDebug() << "read Midi note" <<  i << note_annotation;
-		    nl.push_back(Holdsworth::Note(i));
-		}
-		else {
-		    if (!quiet) {
-			qDebug() << "read note" << note_type << i << note_annotation;
-		    }
-		    ADD_NOTE(note_type.toUInt(), i);
-		}
-
-		if (dumbtab) {
-		    uint stn = note_type.toUInt();
-		    nl.back().setString(stn);
-		    		    
-		}
-
-		if (note_annotation.startsWith("1")) {
-		    nl.back().setFinger(Holdsworth::FirstFinger);
-		    note_annotation.remove("1");
-		}
-		else if (note_annotation.startsWith("2")) {
-		    nl.back().setFinger(Holdsworth::MiddleFinger);
-		    note_annotation.remove("2");
-		}
-		else if (note_annotation.startsWith("3")) {
-		    nl.back().setFinger(Holdsworth::RingFinger);
-		    note_annotation.remove("3");
-		}
-		else if (note_annotation.startsWith("4")) {
-		    nl.back().setFinger(Holdsworth::FourthFinger);
-		    note_annotation.remove("4");
-		}
-
-                if (note_annotation != ".") {
-                    nl.back().addAnnotation(
-			    Holdsworth::Note::annotationFromStr(
-				std::string(note_annotation.toLatin1().data()))); 
-                }
-            }
-            file.close();
+        Holdsworth::TextFormat format = Holdsworth::TextNotes;
+        if (midicsv) {
+            format = Holdsworth::MidiCsv;
+        }
+        else if (dumbtab) {
+            format = Holdsworth::DumbTab;
+        }
+        Holdsworth::NoteCache cache(note_cache_dir);
+        cache.setInput(infilename, QString("text format=%1").arg(format));
+        if (!cache.load(nl, key_sig)) {
+            Holdsworth::loadTextNotes(infilename, nl, t_defn, format);
+            cache.store(nl, key_sig);
         }
     }
 
@@ -398,6 +471,11 @@ int main(int argc, char ** argv)
      * At the moment you have to add this as a sentinel - ugly.
      */
     nl.push_back(Holdsworth::Note(Holdsworth::NotDefined));
+    unsigned int num_notes = nl.size() - 1;
+    for (Holdsworth::Score::iterator part = score.begin(); part != score.end(); ++part) {
+        num_notes += (*part).notes.size();
+        (*part).notes.push_back(Holdsworth::Note(Holdsworth::NotDefined));
+    }
 
 
 
@@ -405,11 +483,71 @@ int main(int argc, char ** argv)
         int p = max_num_passes;
         QTime t;
         t.start();
-        t_engine.compute(nl, p);
+        Holdsworth::NoteList streamed;
+        if (!score.empty()) {
+            t_engine.computeScore(score, p);
+        }
+        else if (lookahead_str.isEmpty()) {
+            t_engine.compute(nl, p);
+        }
+        else {
+            Holdsworth::Note n;
+            t_engine.startStream(lookahead_str.toUInt());
+            for (Holdsworth::ConstNoteIterator ni = nl.begin(); ni != nl.end(); ++ni) {
+                if (!t_engine.pushNote(*ni)) {
+                    qDebug() << "Streaming stopped at note" << (ni - nl.begin()) + 1;
+                    return 1;
+                }
+                while (t_engine.takeNote(n)) {
+                    streamed.push_back(n);
+                }
+            }
+            t_engine.flushStream();
+            while (t_engine.takeNote(n)) {
+                streamed.push_back(n);
+            }
+        }
         int time_taken = t.elapsed();
+        const Holdsworth::EngineStatistics& es = t_engine.statistics();
         if (stats) {
-            std::cout << nl.size() << " notes rendered in " << time_taken << "ms. (";
-            std::cout << (nl.size() * 1000) / time_taken << " notes/sec)" << std::endl;
+            std::cout << num_notes << " notes rendered in " << time_taken << "ms. (";
+            std::cout << (num_notes * 1000) / qMax(time_taken, 1) << " notes/sec)" << std::endl;
+            std::cout << "Segments: " << es.segments << std::endl;
+            std::cout << "Passes: " << es.passes << std::endl;
+            std::cout << "Chunk candidates: " << es.chunk_candidates << " ("
+                << es.chunks_pruned << " pruned)" << std::endl;
+            std::cout << "Chunk cache: " << es.chunk_cache_hits << " hits, "
+                << es.chunk_cache_misses << " misses" << std::endl;
+            std::cout << "Chunks generated: " << es.chunks_generated << std::endl;
+            std::cout << "Auto-hints: " << es.hints_inserted << " inserted, "
+                << es.hints_purged << " purged" << std::endl;
+            if (global || !lookahead_str.isEmpty()) {
+                std::cout << "Search states: " << es.search_states << std::endl;
+            }
+            std::cout << "Cost: " << es.cost << ", " << es.shifts << " shifts" << std::endl;
+            if (!result_cache_dir.isEmpty()) {
+                Holdsworth::ResultCacheStatistics rs = result_cache.statistics();
+                std::cout << "Result cache: " << rs.hits << " hits (" << rs.disk_hits << " from disk) of "
+                    << rs.lookups << " lookups, " << (int) (rs.hitRate() * 100 + 0.5) << "% hit rate" << std::endl;
+            }
+        }
+        if (!json_file.isEmpty()) {
+            QString input = infilename;
+            if (input.isEmpty()) {
+                if (!migt_scale_str.isEmpty()) {
+                    input = "migt-" + migt_scale_str;
+                }
+                else {
+                    input = testname.isEmpty() ? QString("unmerry") : testname;
+                }
+            }
+            if (json_file == "-") {
+                write_statistics_json(std::cout, input, num_notes, time_taken, es);
+            }
+            else {
+                std::ofstream json(json_file.toLocal8Bit().constData(), std::ios::app);
+                write_statistics_json(json, input, num_notes, time_taken, es);
+            }
         }
 
         if (outfilename.isEmpty()) {
@@ -426,34 +564,17 @@ int main(int argc, char ** argv)
         QFile outfile(outfilename);
         if (outfile.open( QIODevice::WriteOnly)) {
             QTextStream outstream(&outfile);
-            outstream << "\\include \"english.ly\"" << endl;
-	    if (eps) {
-		outstream << "\\paper{" << endl;
-		outstream << "    indent=0\\mm" << endl;
-		outstream << "    line-width=180\\mm" << endl;
-		outstream << "    oddFooterMarkup=##f" << endl;
-		outstream << "    oddHeaderMarkup=##f" << endl;
-		outstream << "    bookTitleMarkup = ##f" << endl;
-		outstream << "    scoreTitleMarkup = ##f" << endl;
-		outstream << "}" << endl;
-
-	    }
-	    else {
-		outstream << "\\header{" << endl;
-		outstream << "  title = \"" << outfilename << "\"" << endl;
-		outstream << "  tagline = \\markup \\center-column {\"Tab generated by the Holdsworth library\" \"Command Line: fing " << opts.cmdline() << "\"}" << endl;
-		outstream <<    "}" << endl;
-	    }
-
-            outstream << "frag = {" << endl;
-            t_engine.dumpLilyPond(outstream, use_flats, !no_annotations);
-            outstream << "}" << endl;
-            outstream << "fragt = {" << endl;
-            t_engine.dumpLilyPondTab(outstream);
-            outstream << "}" << endl;
-            outstream << "\\new StaffGroup << \\new Staff { \\clef \"G_8\" " 
-                << Holdsworth::dbgLilypondKeySig(key_sig)
-                << "  \\frag } \\new TabStaff { \\fragt } >> " << endl;
+            writeLilypondHeader(outstream, eps, outfilename, opts.cmdline());
+
+            if (!score.empty()) {
+                writeLilypondScore(outstream, score, key_sig, use_flats, !no_annotations);
+            }
+            else if (lookahead_str.isEmpty()) {
+                writeLilypondLine(outstream, t_engine.output(), &t_engine.diagrams(), key_sig, use_flats, !no_annotations);
+            }
+            else {
+                writeLilypondLine(outstream, streamed, 0, key_sig, use_flats, !no_annotations);
+            }
             
             outfile.close();
         }
@@ -0,0 +1,77 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: MIGT exercise generator.
+ */
+
+#include <iostream>
+#include <QtGlobal>
+#include "migt.h"
+
+using Holdsworth::Note;
+using Holdsworth::NoteList;
+
+void generateMIGT(unsigned int scale, unsigned int step, unsigned int start, unsigned int range, NoteList& nl)
+{
+    bool scale_notes[12];
+
+    std::cout << "MIGT Scale: ";
+    for (uint i = 0; i < 12; ++i) {
+        scale_notes[i] = ((scale & (1 << i)) != 0);
+        if (scale_notes[i]) {
+            std::cout << "O";
+        }
+        else {
+            std::cout << ".";
+        }
+    }
+    std::cout << std::endl;
+
+    uint scale_steps[12];
+    uint num_steps = 0;
+
+    scale_steps[num_steps] = 1;
+    for (uint i = 1; i < 12; ++i) {
+        if (scale_notes[i]) {
+            std::cout << scale_steps[num_steps] << "/";
+            ++num_steps;
+            scale_steps[num_steps] = 1;
+        }
+        else {
+            ++scale_steps[num_steps];
+        }
+    }
+    std::cout << scale_steps[num_steps] << std::endl;
+    if (step == 0) {
+        step = num_steps;
+    }
+    ++num_steps;
+    std::cout << num_steps << " note scale." << std::endl;
+
+    nl.push_back(Note(start));
+
+    for (uint k = 1; k <= step; ++k) {
+        uint start_note = 0;
+        uint this_note = start_note;
+        uint this_step = 0;
+
+        NoteList nl1;
+        do {
+            //std::cout << "Add notes: " << this_note;
+            nl1.push_back(Note(this_note + start));
+            for (uint j = 0; j < k; ++j) {
+                this_note += scale_steps[this_step];
+                this_note %= range;
+                ++this_step;
+                this_step %= num_steps;
+            }
+        } while (this_note != start_note);
+
+        /*
+         * Up the scale (less the start note, which we already have),
+         * then the top note, then back down (less the last step up.)
+         */
+        nl.insert(nl.end(), nl1.begin() + 1, nl1.end());
+        nl.push_back(Note(start + range));
+        nl.insert(nl.end(), nl1.rbegin() + 1, nl1.rend());
+    }
+}
@@ -0,0 +1,22 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: MIGT exercise generator.
+ */
+
+#ifndef FING_MIGT_H
+#define FING_MIGT_H
+
+#include <holdsworth/note.h>
+
+/*!
+ * \brief Append a MIGT exercise to nl.
+ *
+ * \param scale  Bit i is set if the scale includes the note i semitones above the root
+ * \param step   Go up and down the scale in steps of 1 to step notes, or
+ *               0 for every step size
+ * \param start  MIDI note to start on
+ * \param range  Semitones to cover
+ */
+void generateMIGT(unsigned int scale, unsigned int step, unsigned int start, unsigned int range, Holdsworth::NoteList& nl);
+
+#endif
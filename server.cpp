@@ -0,0 +1,619 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: Server mode.
+ */
+
+#include <QTime>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <holdsworth/instrumentdefn.h>
+#include <holdsworth/constraints.h>
+#include <holdsworth/engine.h>
+#include <holdsworth/vn_algorithm.h>
+#include <holdsworth/musicxmlloader.h>
+#include <holdsworth/notecache.h>
+#include <holdsworth/score.h>
+#include "lilypond.h"
+#include "server.h"
+
+#include <cstring>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+namespace {
+
+    /*!
+     * \brief How many clients of the socket can be served at once. Any more
+     * wait for one to go.
+     */
+    const int server_max_clients = 64;
+
+    /*!
+     * \brief Longest request line taken, in bytes. A longer one is answered
+     * with an error, and thrown away.
+     */
+    const int server_max_line = 16 * 1024 * 1024;
+
+    /*!
+     * \brief Highest MIDI note number.
+     */
+    const int server_max_note_num = 127;
+
+    /*!
+     * \brief Where the results of one client's jobs go.
+     *
+     * Each result is written whole, as one line, in the order they finish.
+     */
+    class ResultChannel
+    {
+    public:
+        explicit ResultChannel(int fd)
+            : fd_(fd)
+            , pending_(0)
+            , broken_(false)
+            {}
+
+        void write(const QByteArray& line)
+        {
+            QMutexLocker lock(&mutex_);
+            QByteArray data = line + '\n';
+            const char *p = data.constData();
+            qint64 left = data.size();
+            while (!broken_ && (left > 0)) {
+                ssize_t n = ::write(fd_, p, left);
+                if (n > 0) {
+                    p += n;
+                    left -= n;
+                }
+                else if ((n < 0) && (errno != EINTR)) {
+                    /* The client has gone; its jobs still finish */
+                    broken_ = true;
+                }
+            }
+        }
+
+        void startJob()
+        {
+            QMutexLocker lock(&mutex_);
+            ++pending_;
+        }
+
+        void finishJob()
+        {
+            QMutexLocker lock(&mutex_);
+            if (--pending_ == 0) {
+                idle_.wakeAll();
+            }
+        }
+
+        /*! \brief Wait for the result of every job to be written.
+         */
+        void waitForJobs()
+        {
+            QMutexLocker lock(&mutex_);
+            while (pending_ > 0) {
+                idle_.wait(&mutex_);
+            }
+        }
+
+    private:
+        int fd_;
+        QMutex mutex_;
+        QWaitCondition idle_;
+        int pending_;
+        bool broken_;
+    };
+
+    /*!
+     * \brief The things a job needs that take some building, made once by
+     * each worker thread and then used for all of its jobs.
+     *
+     * An algorithm is tied to the constraints and instrument of the engine
+     * it is given to, so these can't be shared between threads.
+     */
+    struct WorkerTools
+    {
+        Holdsworth::Constraints constraints;
+        Holdsworth::VNAlgorithm standard;
+        Holdsworth::VNAlgorithmX extended;
+        Holdsworth::VNAlgorithmX2 extended2;
+    };
+
+    QThreadStorage<WorkerTools*> worker_tools;
+
+    /*!
+     * \brief What all the jobs share.
+     */
+    struct ServerContext
+    {
+        ServerContext(Holdsworth::InstrumentDefn& d, const ServerOptions& o)
+            : defn(d)
+            , opts(o)
+            , pool()
+            {}
+
+        Holdsworth::InstrumentDefn& defn;   /*!< Only read, so shared by all */
+        const ServerOptions& opts;
+        QThreadPool pool;
+    };
+
+    bool flag(const QJsonObject& job, const char *name, bool dflt)
+    {
+        QJsonValue v = job.value(name);
+        return v.isBool() ? v.toBool() : dflt;
+    }
+
+    int number(const QJsonObject& job, const char *name, int dflt)
+    {
+        QJsonValue v = job.value(name);
+        return v.isDouble() ? v.toInt() : dflt;
+    }
+
+    /*!
+     * \brief Finger one job, and send back its result.
+     */
+    class ServerJob : public QRunnable
+    {
+    public:
+        ServerJob(const QByteArray& request, ServerContext& context, ResultChannel& channel)
+            : request_(request)
+            , context_(context)
+            , channel_(channel)
+            {}
+
+        virtual void run()
+        {
+            QTime t;
+            t.start();
+
+            QJsonObject result;
+            QString error;
+            QJsonParseError parse_error;
+            QJsonDocument doc = QJsonDocument::fromJson(request_, &parse_error);
+            if (!doc.isObject()) {
+                error = "Bad request: " + parse_error.errorString();
+            }
+            else {
+                QJsonObject job = doc.object();
+                if (job.contains("id")) {
+                    result.insert("id", job.value("id"));
+                }
+                if (finger(job, result, error)) {
+                    result.insert("ok", true);
+                }
+            }
+            if (!error.isEmpty()) {
+                result.insert("ok", false);
+                result.insert("error", error);
+            }
+            result.insert("ms", t.elapsed());
+
+            channel_.write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+            channel_.finishJob();
+        }
+
+    private:
+        bool readNotes(const QJsonArray& notes, Holdsworth::NoteList& nl, QString& error);
+        bool loadInput(const QJsonObject& job, const QString& path, Holdsworth::Score& score, int& key_sig, QString& error);
+        bool finger(const QJsonObject& job, QJsonObject& result, QString& error);
+
+        QByteArray request_;
+        ServerContext& context_;
+        ResultChannel& channel_;
+    };
+
+    bool ServerJob::readNotes(const QJsonArray& notes, Holdsworth::NoteList& nl, QString& error)
+    {
+        const Holdsworth::InstrumentStringList& strings = context_.defn.strings();
+        int max_fret = 0;
+        for (Holdsworth::InstrumentStringList::const_iterator s = strings.begin(); s != strings.end(); ++s) {
+            max_fret = qMax(max_fret, (*s).num_frets);
+        }
+
+        for (QJsonArray::const_iterator i = notes.begin(); i != notes.end(); ++i) {
+            QString where = QString::number((int) nl.size() + 1);
+            if ((*i).isDouble()) {
+                int note_num = (*i).toInt();
+                if ((note_num < 0) || (note_num > server_max_note_num)) {
+                    error = "Bad note number in note " + where;
+                    return false;
+                }
+                nl.push_back(Holdsworth::Note(note_num));
+                continue;
+            }
+            if (!(*i).isObject() || !(*i).toObject().value("note").isDouble()) {
+                error = "Bad note " + where;
+                return false;
+            }
+
+            /*
+             * Check everything against the instrument before it goes into
+             * the note, which only has room for small numbers.
+             */
+            QJsonObject n = (*i).toObject();
+            int note_num = n.value("note").toInt();
+            int strg = number(n, "string", Holdsworth::NotDefined);
+            int fret = number(n, "fret", Holdsworth::NotDefined);
+            int finger = number(n, "finger", Holdsworth::NoFingerDefined);
+            if ((note_num < 0) || (note_num > server_max_note_num)) {
+                error = "Bad note number in note " + where;
+                return false;
+            }
+            if ((strg != Holdsworth::NotDefined) && ((strg < 1) || (strg > (int) strings.size()))) {
+                error = "Bad string in note " + where;
+                return false;
+            }
+            if ((fret != Holdsworth::NotDefined)
+                && ((fret < 0) || (fret > ((strg != Holdsworth::NotDefined) ? strings[strg - 1].num_frets : max_fret)))) {
+                error = "Bad fret in note " + where;
+                return false;
+            }
+            if ((finger < Holdsworth::NoFingerDefined) || (finger > Holdsworth::FourthFinger)) {
+                error = "Bad finger in note " + where;
+                return false;
+            }
+
+            nl.push_back(Holdsworth::Note(note_num));
+            Holdsworth::Note& note = nl.back();
+            note.setDuration(number(n, "duration", note.duration()));
+            note.setString(strg);
+            note.setFret(fret);
+            note.setFinger((Holdsworth::FingerNum) finger);
+            QString hint = n.value("hint").toString();
+            for (int c = 0; c < hint.length(); ++c) {
+                note.addAnnotation(Holdsworth::Note::annotationFromStr(QString(hint[c]).toStdString()));
+            }
+        }
+        return true;
+    }
+
+    bool ServerJob::loadInput(const QJsonObject& job, const QString& path, Holdsworth::Score& score, int& key_sig, QString& error)
+    {
+        const ServerOptions& opts = context_.opts;
+        Holdsworth::NoteCache cache(opts.note_cache_dir);
+
+        if (flag(job, "musicxml", opts.musicxml)) {
+            bool force = flag(job, "force", opts.force);
+            int note_offset = number(job, "note-offset", opts.note_offset);
+            cache.setInput(path, QString("musicxml score force=%1 offset=%2").arg(force).arg(note_offset));
+            if (!cache.load(score, key_sig)) {
+                Holdsworth::loadMusicXML(path, score, force, key_sig, note_offset);
+                cache.store(score, key_sig);
+            }
+        }
+        else {
+            Holdsworth::TextFormat format = opts.format;
+            if (flag(job, "midicsv", false)) {
+                format = Holdsworth::MidiCsv;
+            }
+            else if (flag(job, "dumbtab", false)) {
+                format = Holdsworth::DumbTab;
+            }
+            score.resize(1);
+            cache.setInput(path, QString("text format=%1").arg(format));
+            if (!cache.load(score[0].notes, key_sig)) {
+                if (!Holdsworth::loadTextNotes(path, score[0].notes, context_.defn, format)) {
+                    error = "Can't read " + path;
+                    return false;
+                }
+                cache.store(score[0].notes, key_sig);
+            }
+        }
+        return true;
+    }
+
+    bool ServerJob::finger(const QJsonObject& job, QJsonObject& result, QString& error)
+    {
+        const ServerOptions& opts = context_.opts;
+
+        /*
+         * The notes
+         */
+        Holdsworth::Score score;
+        int key_sig = 0;
+        QString title;
+        if (job.value("notes").isArray()) {
+            score.resize(1);
+            if (!readNotes(job.value("notes").toArray(), score[0].notes, error)) {
+                return false;
+            }
+            title = "notes";
+        }
+        else if (job.value("input").isString()) {
+            title = job.value("input").toString();
+            if (!loadInput(job, title, score, key_sig, error)) {
+                return false;
+            }
+        }
+        else {
+            error = "No input or notes";
+            return false;
+        }
+
+        unsigned int num_notes = 0;
+        for (Holdsworth::Score::iterator part = score.begin(); part != score.end(); ++part) {
+            num_notes += (*part).notes.size();
+            (*part).notes.push_back(Holdsworth::Note(Holdsworth::NotDefined));
+        }
+        if (num_notes == 0) {
+            error = "No notes in " + title;
+            return false;
+        }
+
+        /*
+         * The engine, as the command line would set it up
+         */
+        if (!worker_tools.hasLocalData()) {
+            worker_tools.setLocalData(new WorkerTools);
+        }
+        WorkerTools *tools = worker_tools.localData();
+
+        Holdsworth::Algorithm *alg = &tools->standard;
+        int hand = opts.hand;
+        if (job.value("extended2").isBool() || job.value("extended").isBool()) {
+            hand = flag(job, "extended2", false) ? 2 : (flag(job, "extended", false) ? 1 : 0);
+        }
+        if (hand == 2) {
+            alg = &tools->extended2;
+        }
+        else if (hand == 1) {
+            alg = &tools->extended;
+        }
+
+        Holdsworth::CostWeights weights;
+        QJsonObject changes = job.value("weights").toObject();
+        for (QJsonObject::const_iterator w = changes.begin(); w != changes.end(); ++w) {
+            if (!w.value().isDouble() || !weights.set(w.key().toStdString(), w.value().toInt())) {
+                error = "Bad weight " + w.key();
+                return false;
+            }
+        }
+        alg->setCostWeights(weights);
+
+        tools->constraints.setBTBGliss(flag(job, "back-to-back", opts.back_to_back));
+
+        Holdsworth::Engine engine;
+        int max_lh_shift = number(job, "maxshift", opts.max_lh_shift);
+        if (max_lh_shift != 0) {
+            engine.setMaxLHShift(max_lh_shift);
+        }
+        if (flag(job, "global", opts.global)) {
+            engine.setSearchMode(Holdsworth::Engine::GlobalSearch);
+        }
+        engine.setSplitAtRestarts(flag(job, "segments", opts.segments));
+        engine.setInstrument(&context_.defn);
+        engine.setAlgorithm(alg);
+        engine.setConstraints(&tools->constraints);
+        if (opts.result_cache != 0) {
+            engine.setResultCache(opts.result_cache);
+        }
+
+        bool ok = engine.computeScore(score, number(job, "max-passes", opts.max_passes));
+
+        const Holdsworth::EngineStatistics& es = engine.statistics();
+        result.insert("notes", (int) num_notes);
+        result.insert("cost", es.cost);
+        result.insert("shifts", (int) es.shifts);
+        result.insert("result_cache_hits", (int) es.result_cache_hits);
+
+        /*
+         * The fingering
+         */
+        if (job.value("output").toString() == "lilypond") {
+            bool use_flats = flag(job, "use-flats", opts.use_flats || (key_sig < 0));
+            bool annotations = !flag(job, "no-annotations", !opts.annotations);
+            QString text;
+            QTextStream os(&text);
+            writeLilypondHeader(os, flag(job, "eps", opts.eps), title, "--server");
+            if (score.size() == 1) {
+                writeLilypondLine(os, score[0].output, &score[0].diagrams, key_sig, use_flats, annotations);
+            }
+            else {
+                writeLilypondScore(os, score, key_sig, use_flats, annotations);
+            }
+            os.flush();
+            result.insert("lilypond", text);
+        }
+        else {
+            QJsonArray parts;
+            for (Holdsworth::Score::const_iterator part = score.begin(); part != score.end(); ++part) {
+                QJsonArray notes;
+                for (Holdsworth::ConstNoteIterator ni = (*part).output.begin(); ni != (*part).output.end(); ++ni) {
+                    if ((*ni).noteNum() == Holdsworth::NotDefined) {
+                        continue;
+                    }
+                    QJsonObject n;
+                    n.insert("note", (*ni).noteNum());
+                    n.insert("duration", (*ni).duration());
+                    n.insert("string", (*ni).stringNum());
+                    n.insert("fret", (*ni).fretNum());
+                    n.insert("finger", (int) (*ni).fingerNum());
+                    n.insert("annotation", QString::fromStdString((*ni).annotationAsStr()));
+                    notes.append(n);
+                }
+                QJsonObject p;
+                p.insert("id", QString::fromStdString((*part).id));
+                p.insert("voice", (*part).voice);
+                p.insert("ok", (*part).ok);
+                p.insert("notes", notes);
+                parts.append(p);
+            }
+            result.insert("parts", parts);
+        }
+
+        if (!ok) {
+            error = "Can't finger " + title;
+        }
+        return ok;
+    }
+
+    /*!
+     * \brief Read a line from fd into line, without the newline.
+     *
+     * A line longer than server_max_line is thrown away as it comes in, and
+     * too_long set instead.
+     *
+     * \return false at the end of the input.
+     */
+    bool readLine(int fd, QByteArray& buffer, QByteArray& line, bool& too_long)
+    {
+        too_long = false;
+        for (;;) {
+            int eol = buffer.indexOf('\n');
+            if ((eol > server_max_line) || ((eol < 0) && (buffer.size() > server_max_line))) {
+                too_long = true;
+                buffer.remove(0, (eol < 0) ? buffer.size() : eol);
+                continue;
+            }
+            if (eol >= 0) {
+                line = too_long ? QByteArray() : buffer.left(eol);
+                buffer.remove(0, eol + 1);
+                return true;
+            }
+
+            char chunk[4096];
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n > 0) {
+                buffer.append(chunk, n);
+            }
+            else if ((n < 0) && (errno == EINTR)) {
+                continue;
+            }
+            else {
+                line = too_long ? QByteArray() : buffer;
+                buffer.clear();
+                return too_long || !line.isEmpty();
+            }
+        }
+    }
+
+    /*!
+     * \brief Start a job for each line read from in_fd, with the results
+     * going to out_fd, and wait for them all to finish.
+     */
+    void serve(int in_fd, int out_fd, ServerContext& context)
+    {
+        ResultChannel channel(out_fd);
+        QByteArray buffer;
+        QByteArray line;
+        bool too_long;
+        while (readLine(in_fd, buffer, line, too_long)) {
+            if (too_long) {
+                QJsonObject result;
+                result.insert("ok", false);
+                result.insert("error", QString("Request longer than %1 bytes").arg(server_max_line));
+                channel.write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+                continue;
+            }
+            if (line.trimmed().isEmpty()) {
+                continue;
+            }
+            channel.startJob();
+            context.pool.start(new ServerJob(line, context, channel));
+        }
+        channel.waitForJobs();
+    }
+
+    /*!
+     * \brief Serve one client of the socket.
+     */
+    class ClientWorker : public QRunnable
+    {
+    public:
+        ClientWorker(int fd, ServerContext& context)
+            : fd_(fd)
+            , context_(context)
+            {}
+
+        virtual void run()
+        {
+            serve(fd_, fd_, context_);
+            ::close(fd_);
+        }
+
+    private:
+        int fd_;
+        ServerContext& context_;
+    };
+}
+
+int runServer(const QString& socket, Holdsworth::InstrumentDefn& defn, const ServerOptions& opts)
+{
+    ServerContext context(defn, opts);
+    if (opts.threads > 0) {
+        context.pool.setMaxThreadCount(opts.threads);
+    }
+
+    /*
+     * A client that goes away shouldn't take the server with it.
+     */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (socket.isEmpty()) {
+        serve(0, 1, context);
+        return 0;
+    }
+
+#ifdef Q_OS_UNIX
+    QByteArray path = QFile::encodeName(socket);
+    struct sockaddr_un addr;
+    if (path.size() >= (int) sizeof(addr.sun_path)) {
+        qDebug() << "Socket name too long:" << socket;
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.constData(), path.size());
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        qDebug() << "Can't make socket:" << strerror(errno);
+        return 1;
+    }
+    /* Left over from an earlier server, but don't remove anything else */
+    struct stat st;
+    if ((lstat(path.constData(), &st) == 0) && S_ISSOCK(st.st_mode)) {
+        unlink(path.constData());
+    }
+    if ((bind(listener, (struct sockaddr *) &addr, sizeof(addr)) < 0) || (listen(listener, SOMAXCONN) < 0)) {
+        qDebug() << "Can't listen on" << socket << ":" << strerror(errno);
+        ::close(listener);
+        return 1;
+    }
+
+    QThreadPool clients;
+    clients.setMaxThreadCount(server_max_clients);
+    for (;;) {
+        int fd = accept(listener, 0, 0);
+        if (fd >= 0) {
+            clients.start(new ClientWorker(fd, context));
+        }
+        else if (errno != EINTR) {
+            qDebug() << "Can't accept on" << socket << ":" << strerror(errno);
+            break;
+        }
+    }
+    ::close(listener);
+    clients.waitForDone();
+    return 1;
+#else
+    qDebug() << "--server=SOCKET needs Unix domain sockets";
+    return 1;
+#endif
+}
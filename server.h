@@ -0,0 +1,106 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: Server mode. Finger a stream of jobs in one long-running process,
+ * rather than starting fing for each of them.
+ */
+
+#ifndef FING_SERVER_H
+#define FING_SERVER_H
+
+#include <QString>
+#include <holdsworth/textloader.h>
+
+namespace Holdsworth {
+    class InstrumentDefn;
+    class ResultCache;
+}
+
+/*!
+ * \brief The settings for jobs that don't give their own, from the
+ * command line.
+ */
+struct ServerOptions
+{
+    ServerOptions()
+        : hand(0)
+        , back_to_back(false)
+        , global(false)
+        , segments(false)
+        , max_lh_shift(0)
+        , max_passes(50)
+        , threads(0)
+        , musicxml(false)
+        , format(Holdsworth::TextNotes)
+        , force(false)
+        , note_offset(0)
+        , use_flats(false)
+        , annotations(true)
+        , eps(false)
+        , note_cache_dir()
+        , result_cache(0)
+        {}
+
+    int hand;                       /*!< 0 standard, 1 extended, 2 double extended */
+    bool back_to_back;
+    bool global;
+    bool segments;
+    int max_lh_shift;               /*!< 0 for the engine default */
+    unsigned int max_passes;
+    int threads;                    /*!< Jobs at once; 0 for one per core */
+
+    bool musicxml;                  /*!< Input files are MusicXML... */
+    Holdsworth::TextFormat format;  /*!< ...or else text in this format */
+    bool force;
+    int note_offset;
+
+    bool use_flats;
+    bool annotations;
+    bool eps;
+
+    QString note_cache_dir;         /*!< Empty for none */
+    Holdsworth::ResultCache *result_cache;  /*!< Shared by every job, if not 0 */
+};
+
+/*!
+ * \brief Finger jobs until the input ends (or, for a socket, forever.)
+ *
+ * Jobs are read one per line, as JSON objects, from stdin, or if socket is
+ * given, from every client that connects to the Unix domain socket of that
+ * name. They are fingered on a pool of threads, and the result of each is
+ * written back (to stdout, or to the client) as a line of JSON as soon as
+ * it is ready, so results may come back in a different order from the
+ * jobs. A client's connection is kept open until all of its results have
+ * been written.
+ *
+ * A job has the notes to finger, as either
+ *
+ *     "input": FILE       a file, read as the command line options say, or
+ *     "notes": [...]      the notes themselves: a MIDI note number (0 for
+ *                         a rest) or {"note": N, "duration": D, "string": S,
+ *                         "fret": F, "finger": X, "hint": "="} for each
+ *
+ * and may also have
+ *
+ *     "id": ANYTHING      copied to the result, to match it with the job
+ *     "output": "notes" or "lilypond"   what to send back (default notes)
+ *     "weights": {"note_bonus": -5, ...}  cost weights to change (only
+ *                         note_bonus and position_break_threshold may be
+ *                         negative)
+ *
+ * along with any of the command line options "musicxml", "midicsv",
+ * "dumbtab", "force", "note-offset", "extended", "extended2",
+ * "back-to-back", "maxshift", "max-passes", "global", "segments",
+ * "use-flats", "no-annotations" and "eps", for just that job.
+ *
+ * The result has "id", "ok", "ms", "notes" (the number fingered), "cost",
+ * "shifts" and "result_cache_hits", and either "parts": [{"id": PART,
+ * "voice": V, "ok": true, "notes": [{"note": N, "duration": D, "string":
+ * S, "fret": F, "finger": X, "annotation": "*"}, ...]}, ...] or
+ * "lilypond": TEXT. If the job can't be done, "ok" is false and "error"
+ * says why.
+ *
+ * \return The exit status for fing.
+ */
+int runServer(const QString& socket, Holdsworth::InstrumentDefn&, const ServerOptions&);
+
+#endif
@@ -0,0 +1,242 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: Cost weight sweeps.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <QFile>
+#include <QDir>
+#include <QTime>
+#include <QTextStream>
+#include <QStringList>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QDebug>
+#include <holdsworth/instrumentdefn.h>
+#include <holdsworth/constraints.h>
+#include <holdsworth/engine.h>
+#include <holdsworth/vn_algorithm.h>
+#include <holdsworth/musicxmlloader.h>
+#include "sweep.h"
+
+namespace {
+
+    /*!
+     * \brief The outcome of fingering one input with one configuration.
+     */
+    struct SweepResult
+    {
+        SweepResult()
+            : ok(false)
+            , cost(0)
+            , shifts(0)
+            , notes(0)
+            , ms(0)
+            {}
+
+        bool ok;
+        int cost;
+        unsigned int shifts;
+        unsigned int notes;
+        int ms;
+    };
+
+    /*!
+     * \brief Finger one input with one configuration. Each job has its own
+     * algorithm and engine; only the instrument (and so its candidate
+     * table) is shared, and that is read-only.
+     */
+    class SweepJob : public QRunnable
+    {
+    public:
+        SweepJob(const SweepConfig& config, const SweepInput& input,
+                Holdsworth::InstrumentDefn *defn, const SweepOptions& opts,
+                SweepResult& result)
+            : config_(config)
+            , input_(input)
+            , defn_(defn)
+            , opts_(opts)
+            , result_(result)
+            {}
+
+        virtual void run()
+        {
+            Holdsworth::Algorithm *alg;
+            if (opts_.hand == 2) {
+                alg = new Holdsworth::VNAlgorithmX2;
+            }
+            else if (opts_.hand == 1) {
+                alg = new Holdsworth::VNAlgorithmX;
+            }
+            else {
+                alg = new Holdsworth::VNAlgorithm;
+            }
+            alg->setCostWeights(config_.weights);
+
+            Holdsworth::Constraints constraints;
+            constraints.setBTBGliss(opts_.back_to_back);
+
+            Holdsworth::Engine engine;
+            if (opts_.max_lh_shift != 0) {
+                engine.setMaxLHShift(opts_.max_lh_shift);
+            }
+            if (opts_.global) {
+                engine.setSearchMode(Holdsworth::Engine::GlobalSearch);
+            }
+            engine.setInstrument(defn_);
+            engine.setAlgorithm(alg);
+            engine.setConstraints(&constraints);
+
+            QTime t;
+            t.start();
+            result_.ok = engine.compute(input_.notes, opts_.max_passes);
+            result_.ms = t.elapsed();
+            result_.cost = engine.statistics().cost;
+            result_.shifts = engine.statistics().shifts;
+            result_.notes = input_.notes.size() - 1;  /* Less the sentinel */
+
+            delete alg;
+        }
+
+    private:
+        const SweepConfig& config_;
+        const SweepInput& input_;
+        Holdsworth::InstrumentDefn *defn_;
+        const SweepOptions& opts_;
+        SweepResult& result_;
+    };
+}
+
+bool readSweepConfigs(QString filename, std::vector<SweepConfig>& configs)
+{
+    configs.clear();
+    configs.push_back(SweepConfig());
+    configs.back().name = "defaults";
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Can't open" << filename;
+        return false;
+    }
+
+    QTextStream stream(&file);
+    int line_num = 0;
+    while (!stream.atEnd()) {
+        QString line = stream.readLine();
+        ++line_num;
+        int comment = line.indexOf('#');
+        if (comment >= 0) {
+            line = line.left(comment);
+        }
+        line = line.simplified();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        SweepConfig config;
+        config.name = line;
+        QStringList settings = line.split(' ');
+        for (QStringList::const_iterator s = settings.begin(); s != settings.end(); ++s) {
+            int eq = (*s).indexOf('=');
+            bool ok = (eq > 0);
+            int value = 0;
+            if (ok) {
+                value = (*s).mid(eq + 1).toInt(&ok);
+            }
+            if (!ok || !config.weights.set((*s).left(eq).toStdString(), value)) {
+                qDebug() << filename << "line" << line_num << ": bad weight" << *s;
+                return false;
+            }
+        }
+        configs.push_back(config);
+    }
+    file.close();
+    return true;
+}
+
+bool loadSweepInputs(QString dirname, Holdsworth::InstrumentDefn& defn, const SweepOptions& opts, std::vector<SweepInput>& inputs)
+{
+    QDir dir(dirname);
+    if (!dir.exists()) {
+        qDebug() << "No such directory" << dirname;
+        return false;
+    }
+
+    QStringList files = dir.entryList(QDir::Files, QDir::Name);
+    for (QStringList::const_iterator f = files.begin(); f != files.end(); ++f) {
+        SweepInput input;
+        input.name = *f;
+        QString path = dir.filePath(*f);
+        if (opts.musicxml) {
+            int key_sig = 0;
+            Holdsworth::loadMusicXML(path, input.notes, opts.force, key_sig, opts.note_offset);
+        }
+        else if (!Holdsworth::loadTextNotes(path, input.notes, defn, opts.format)) {
+            continue;
+        }
+        if (input.notes.empty()) {
+            continue;
+        }
+        input.notes.push_back(Holdsworth::Note(Holdsworth::NotDefined));
+        inputs.push_back(input);
+    }
+    return true;
+}
+
+void runSweep(const std::vector<SweepConfig>& configs, const std::vector<SweepInput>& inputs, Holdsworth::InstrumentDefn& defn, const SweepOptions& opts)
+{
+    std::vector<SweepResult> results(configs.size() * inputs.size());
+
+    QTime t;
+    t.start();
+
+    QThreadPool pool;
+    if (opts.threads > 0) {
+        pool.setMaxThreadCount(opts.threads);
+    }
+    for (unsigned int c = 0; c < configs.size(); ++c) {
+        for (unsigned int i = 0; i < inputs.size(); ++i) {
+            pool.start(new SweepJob(configs[c], inputs[i], &defn, opts, results[c * inputs.size() + i]));
+        }
+    }
+    pool.waitForDone();
+
+    int wall_ms = t.elapsed();
+
+    std::cout << inputs.size() << " inputs, " << configs.size() << " configurations, "
+        << wall_ms << "ms" << std::endl;
+    std::cout << std::setw(10) << "Cost"
+        << std::setw(8) << "Shifts"
+        << std::setw(10) << "Notes"
+        << std::setw(8) << "ms"
+        << std::setw(11) << "Notes/sec"
+        << std::setw(7) << "Failed"
+        << "  Configuration" << std::endl;
+
+    for (unsigned int c = 0; c < configs.size(); ++c) {
+        long cost = 0;
+        unsigned long shifts = 0;
+        unsigned long notes = 0;
+        long ms = 0;
+        unsigned int failed = 0;
+        for (unsigned int i = 0; i < inputs.size(); ++i) {
+            const SweepResult& r = results[c * inputs.size() + i];
+            if (!r.ok) {
+                ++failed;
+                continue;
+            }
+            cost += r.cost;
+            shifts += r.shifts;
+            notes += r.notes;
+            ms += r.ms;
+        }
+        std::cout << std::setw(10) << cost
+            << std::setw(8) << shifts
+            << std::setw(10) << notes
+            << std::setw(8) << ms
+            << std::setw(11) << (notes * 1000) / qMax(ms, 1L)
+            << std::setw(7) << failed
+            << "  " << configs[c].name.toLatin1().data() << std::endl;
+    }
+}
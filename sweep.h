@@ -0,0 +1,90 @@
+/* vim: set cindent ts=8 sts=4 sw=4 expandtab: */
+/*
+ * FING: Cost weight sweeps. Finger a directory of inputs with many sets of
+ * cost weights at once, and compare the results, to help with tuning.
+ */
+
+#ifndef FING_SWEEP_H
+#define FING_SWEEP_H
+
+#include <QString>
+#include <vector>
+#include <holdsworth/note.h>
+#include <holdsworth/costweights.h>
+#include <holdsworth/textloader.h>
+
+namespace Holdsworth {
+    class InstrumentDefn;
+}
+
+/*!
+ * \brief Everything about a sweep other than the weights.
+ */
+struct SweepOptions
+{
+    SweepOptions()
+        : hand(0)
+        , back_to_back(false)
+        , global(false)
+        , max_lh_shift(0)
+        , max_passes(50)
+        , threads(0)
+        , musicxml(false)
+        , format(Holdsworth::TextNotes)
+        , force(false)
+        , note_offset(0)
+        {}
+
+    int hand;                       /*!< 0 standard, 1 extended, 2 double extended */
+    bool back_to_back;
+    bool global;
+    int max_lh_shift;               /*!< 0 for the engine default */
+    unsigned int max_passes;
+    int threads;                    /*!< 0 for one per core */
+
+    bool musicxml;                  /*!< Input files are MusicXML... */
+    Holdsworth::TextFormat format;  /*!< ...or else text in this format */
+    bool force;
+    int note_offset;
+};
+
+/*!
+ * \brief A set of cost weights to try, and what to call it in the report.
+ */
+struct SweepConfig
+{
+    QString name;
+    Holdsworth::CostWeights weights;
+};
+
+/*!
+ * \brief An input file, parsed once and shared by all the configurations.
+ */
+struct SweepInput
+{
+    QString name;
+    Holdsworth::NoteList notes;
+};
+
+/*!
+ * \brief Read the configurations to try from a file.
+ *
+ * Each line is a set of weights, as space-separated name=value pairs (see
+ * Holdsworth::CostWeights::set()); weights that aren't mentioned keep
+ * their default values. Anything after a '#' is ignored. The defaults
+ * themselves are always tried first.
+ */
+bool readSweepConfigs(QString filename, std::vector<SweepConfig>&);
+
+/*!
+ * \brief Parse every file in a directory.
+ */
+bool loadSweepInputs(QString dirname, Holdsworth::InstrumentDefn&, const SweepOptions&, std::vector<SweepInput>&);
+
+/*!
+ * \brief Finger every input with every configuration, in parallel, and
+ * print the total cost, position shifts and throughput of each configuration.
+ */
+void runSweep(const std::vector<SweepConfig>&, const std::vector<SweepInput>&, Holdsworth::InstrumentDefn&, const SweepOptions&);
+
+#endif